@@ -0,0 +1,547 @@
+#include "../src/base.hpp"
+#include "../src/bindless.hpp"
+#include "../src/compute.hpp"
+#include "../src/cull.hpp"
+#include "../src/instancing.hpp"
+#include "../src/offscreen.hpp"
+#include "../src/pipeline_batch.hpp"
+#include "../src/recorder.hpp"
+#include "../src/upload.hpp"
+#include "../src/thread_pool.hpp"
+#include "../src/uniform_ring.hpp"
+#include "../src/ll/shader.hpp"
+#include "../src/ll/rpass.hpp"
+#include "../src/ll/image.hpp"
+#include "../src/ll/pipeline.hpp"
+#include "../src/ll/cbuf.hpp"
+#include "../src/ll/descriptor.hpp"
+#include "../src/ll/sync.hpp"
+#include "../src/ll/memory.hpp"
+#include "../src/ll/query.hpp"
+#include "../src/timer.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Renders the same thing as Testing into an offscreen image, so it can run
+// on machines without a display (e.g. CI with a software ICD). Reports
+// throughput and optionally writes the last frame out or compares it to a
+// golden image.
+//
+// Usage: Headless [frame count] [--out file.ppm] [--golden file.ppm] [--tolerance n]
+//                 [--draws n] [--slices n] [--stats file.json] [--grid n] [--cull]
+//                 [--async] [--instanced] [--msaa n] [--bindless] [--uniforms]
+//
+// --draws repeats the draw call to put load on the CPU. With --slices, the
+// draws are split up and recorded into secondary command buffers on that
+// many threads. --stats writes frame time percentiles as JSON. The mesh
+// is a grid of n by n quads. --cull frustum culls the quads on the GPU and
+// draws the visible ones with a single indirect draw. --async does the
+// culling on the async compute queue instead, through compute::AsyncQueue,
+// with the draws changing queue families if needed. --instanced draws
+// every quad as an instance of one unit quad instead, batched with
+// instancing::Batcher. --msaa renders with n samples per pixel into a
+// transient image that is resolved into the target. --bindless shades the
+// quads with bindless.frag, which reads a (white) tint from a buffer it
+// picks out of a bindless::Table by index. --uniforms gives every repeated
+// draw its own (zero) offset, pushed into a uniform_ring::Ring and picked
+// with a dynamic offset.
+
+const uint32_t WIDTH = 800, HEIGHT = 600;
+const uint32_t DEFAULT_FRAME_CT = 1000;
+const uint32_t FRAMES_IN_FLIGHT = 2;
+const char* PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+
+struct Options {
+	uint32_t frame_ct = DEFAULT_FRAME_CT;
+	std::string out;
+	std::string golden;
+	uint8_t tolerance = 0;
+	uint32_t draw_ct = 1;
+	// Zero records inline on the main thread
+	uint32_t slice_ct = 0;
+	std::string stats;
+	uint32_t grid_size = 1;
+	bool cull = false;
+	bool async = false;
+	bool instanced = false;
+	uint32_t samples = 1;
+	bool bindless = false;
+	bool uniforms = false;
+};
+
+auto parse_args(int argc, char** argv) -> Options {
+	Options opts;
+	std::vector<std::string> args(argv + 1, argv + argc);
+
+	for (size_t i = 0; i < args.size(); ++i) {
+		auto has_value = i + 1 < args.size();
+		if (args[i] == "--out" && has_value) opts.out = args[++i];
+		else if (args[i] == "--golden" && has_value) opts.golden = args[++i];
+		else if (args[i] == "--tolerance" && has_value)
+			opts.tolerance = static_cast<uint8_t>(std::stoul(args[++i]));
+		else if (args[i] == "--draws" && has_value) opts.draw_ct = std::stoul(args[++i]);
+		else if (args[i] == "--slices" && has_value) opts.slice_ct = std::stoul(args[++i]);
+		else if (args[i] == "--stats" && has_value) opts.stats = args[++i];
+		else if (args[i] == "--grid" && has_value) opts.grid_size = std::stoul(args[++i]);
+		else if (args[i] == "--cull") opts.cull = true;
+		else if (args[i] == "--async") opts.async = true;
+		else if (args[i] == "--instanced") opts.instanced = true;
+		else if (args[i] == "--msaa" && has_value) opts.samples = std::stoul(args[++i]);
+		else if (args[i] == "--bindless") opts.bindless = true;
+		else if (args[i] == "--uniforms") opts.uniforms = true;
+		else opts.frame_ct = std::stoul(args[i]);
+	}
+
+	if (opts.frame_ct == 0) throw std::runtime_error("Need to render at least one frame!");
+	if (opts.grid_size == 0) throw std::runtime_error("Grid needs at least one quad!");
+	if (opts.cull && opts.instanced) throw std::runtime_error("--cull and --instanced can't be combined!");
+	if (opts.async && !opts.cull) throw std::runtime_error("--async only applies to --cull!");
+	// The instanced shader doesn't read per-draw uniforms, and both the
+	// ring and the bindless table want set 0
+	if (opts.uniforms && (opts.instanced || opts.bindless))
+		throw std::runtime_error("--uniforms can't be combined with --instanced or --bindless!");
+	if (opts.samples == 0 || (opts.samples & (opts.samples - 1)) != 0 || opts.samples > 64)
+		throw std::runtime_error("Sample count has to be a power of two up to 64!");
+
+	return opts;
+}
+
+struct Vertex {
+	std::array<float, 2> pos;
+	std::array<float, 3> color;
+};
+
+// Offset, size and color of every quad when drawn instanced
+const std::vector<instancing::Stream> INSTANCE_STREAMS = {
+	{VK_FORMAT_R32G32_SFLOAT, 8},
+	{VK_FORMAT_R32G32_SFLOAT, 8},
+	{VK_FORMAT_R32G32B32_SFLOAT, 12}
+};
+
+// Size by size clockwise quads with gaps between them, colored by position.
+// Every quad is also an object for culling.
+void make_grid(uint32_t size, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+	       std::vector<cull::Object>& objects) {
+	const float MIN = -0.9F, EXTENT = 1.8F;
+	auto cell = EXTENT / size;
+	auto gap = cell * 0.1F;
+
+	for (uint32_t y = 0; y < size; ++y) {
+		for (uint32_t x = 0; x < size; ++x) {
+			auto left = MIN + x * cell + gap, right = MIN + (x + 1) * cell - gap;
+			auto top = MIN + y * cell + gap, bottom = MIN + (y + 1) * cell - gap;
+			std::array<float, 3> color = {static_cast<float>(x + 1) / size,
+						      static_cast<float>(y + 1) / size, 0.5F};
+
+			auto half_width = (right - left) / 2, half_height = (bottom - top) / 2;
+			cull::Object object{};
+			object.center = {left + half_width, top + half_height, 0.0F};
+			object.radius = std::sqrt(half_width * half_width + half_height * half_height);
+			object.index_ct = 6;
+			object.first_index = static_cast<uint32_t>(indices.size());
+			objects.push_back(object);
+
+			auto first = static_cast<uint32_t>(vertices.size());
+			vertices.push_back({{left, top}, color});
+			vertices.push_back({{right, top}, color});
+			vertices.push_back({{right, bottom}, color});
+			vertices.push_back({{left, bottom}, color});
+
+			for (auto idx : {0U, 1U, 2U, 2U, 3U, 0U}) indices.push_back(first + idx);
+		}
+	}
+}
+
+auto run(const Options& opts) -> int {
+	// No surface, no present queue, no swapchain extension
+	base::Base base(std::make_unique<base::Default>(std::vector<const char *>{},
+							std::vector<const char *>{}));
+
+	std::cout << "Using device: " << base.phys_dev_name << std::endl;
+
+	auto vs = ll::shader::create(base.device, VK_SHADER_STAGE_VERTEX_BIT,
+				     opts.uniforms ? "shaders/per_draw.vert.spv" : "shaders/mesh.vert.spv");
+	auto fs = ll::shader::create(base.device, VK_SHADER_STAGE_FRAGMENT_BIT,
+				     opts.bindless ? "shaders/bindless.frag.spv" : "shaders/mesh.frag.spv");
+	std::array<VkPipelineShaderStageCreateInfo, 2> shaders = {vs, fs};
+
+	ll::memory::Allocator allocator(base.phys_dev, base.device);
+	auto target = offscreen::create(allocator, base.device, WIDTH, HEIGHT);
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<cull::Object> objects;
+	make_grid(opts.grid_size, vertices, indices, objects);
+	auto grid = upload::mesh(allocator, base.device, base.queues.graphics, base.queue_fams.graphics.value(),
+				 vertices, indices);
+
+	// Every draw picks the same tint, white so the image doesn't change
+	std::unique_ptr<bindless::Table> table;
+	upload::Buffer tint{};
+	uint32_t tint_idx = 0;
+	if (opts.bindless) {
+		table = std::make_unique<bindless::Table>(base.phys_dev, base.device);
+		std::array<float, 3> white = {1.0F, 1.0F, 1.0F};
+		tint = upload::buffers(allocator, base.device, base.queues.graphics, base.queue_fams.graphics.value(),
+				       {{white.data(), sizeof(white), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT}},
+				       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT)[0];
+		tint_idx = table->add_buffer(tint.handle);
+		table->flush();
+	}
+
+	// Room for a block per repeated draw, which is at most the ring's
+	// range apart
+	std::unique_ptr<uniform_ring::Ring> ring;
+	VkDescriptorSetLayout uniform_set_lt = VK_NULL_HANDLE;
+	VkDescriptorPool uniform_pool = VK_NULL_HANDLE;
+	VkDescriptorSet uniform_set = VK_NULL_HANDLE;
+	if (opts.uniforms) {
+		ring = std::make_unique<uniform_ring::Ring>(allocator, base.phys_dev, base.device, FRAMES_IN_FLIGHT,
+							    opts.draw_ct * uniform_ring::DEFAULT_RANGE);
+		uniform_set_lt = ll::descriptor::layout(base.device, {
+			ll::descriptor::binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+		});
+		uniform_pool = ll::descriptor::pool(base.device, 1, {{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1}});
+		uniform_set = ll::descriptor::allocate(base.device, uniform_pool, uniform_set_lt);
+
+		ll::descriptor::Writer writer;
+		ring->write_descriptor(writer, uniform_set, 0);
+		writer.flush(base.device);
+	}
+
+	// Shared by every pipeline, the instanced one included
+	VkPipelineLayout pipeline_lt = VK_NULL_HANDLE;
+	if (table) pipeline_lt = ll::pipeline::layout(base.device, {table->set_layout}, {bindless::INDEX_PUSH_RANGE});
+	else if (ring) pipeline_lt = ll::pipeline::layout(base.device, {uniform_set_lt});
+	else pipeline_lt = ll::pipeline::layout(base.device);
+
+	auto samples = static_cast<VkSampleCountFlagBits>(opts.samples);
+	if (ll::image::max_samples(base.phys_dev, samples) != samples)
+		throw std::runtime_error("Device doesn't support " + std::to_string(opts.samples) + " samples!");
+
+	// Render pass, which leaves the image ready to be copied. With MSAA
+	// the samples live in a transient image and only the resolved
+	// result is stored.
+	auto attachment_settings = ll::rpass::ATTACHMENT_DEFAULTS;
+	attachment_settings.final_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	std::vector<VkAttachmentDescription> attachments = {ll::rpass::attachment(target.format, attachment_settings)};
+	auto color_ref = ll::rpass::attachment_ref(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	auto resolve_ref = ll::rpass::attachment_ref(1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+	VkImage msaa_image = VK_NULL_HANDLE;
+	ll::memory::Allocation msaa_memory{};
+	VkImageView msaa_view = VK_NULL_HANDLE;
+	std::vector<VkImageView> fb_views = {target.view};
+	if (samples != VK_SAMPLE_COUNT_1_BIT) {
+		auto msaa_settings = ll::rpass::MSAA_ATTACHMENT_DEFAULTS;
+		msaa_settings.samples = samples;
+		auto resolve_settings = ll::rpass::RESOLVE_ATTACHMENT_DEFAULTS;
+		resolve_settings.final_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		attachments = {ll::rpass::attachment(target.format, msaa_settings),
+			       ll::rpass::attachment(target.format, resolve_settings)};
+
+		msaa_image = ll::image::transient(base.device, target.format, WIDTH, HEIGHT,
+						  VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, samples);
+		msaa_memory = allocator.bind(msaa_image, false, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+					     VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+		msaa_view = ll::image::to_view(base.device, msaa_image, target.format);
+		fb_views = {msaa_view, target.view};
+	}
+
+	auto subpass = ll::rpass::subpass(1, &color_ref, nullptr,
+					  samples != VK_SAMPLE_COUNT_1_BIT ? &resolve_ref : nullptr);
+	std::array<VkSubpassDependency, 2> subpass_deps = {
+		ll::rpass::dependency(),
+		// Resolving counts as a color attachment write, so this covers
+		// it too
+		ll::rpass::dependency(offscreen::READBACK_DEPENDENCY)
+	};
+	auto rpass = ll::rpass::rpass(base.device, attachments.size(), attachments.data(), 1, &subpass,
+				      subpass_deps.size(), subpass_deps.data());
+
+	auto pipeline_cache = ll::pipeline::load_cache(base.phys_dev, base.device, PIPELINE_CACHE_FILE);
+	// Only one pipeline here, but this is how a scene with many
+	// permutations would build them
+	thread_pool::ThreadPool pool;
+	auto settings = ll::pipeline::PIPELINE_DEFAULTS;
+	settings.samples = samples;
+	settings.vertex_bindings = {ll::pipeline::vertex_binding(0, sizeof(Vertex))};
+	settings.vertex_attributes = {
+		ll::pipeline::vertex_attribute(0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, pos)),
+		ll::pipeline::vertex_attribute(1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color))
+	};
+	std::vector<ll::pipeline::PipelineDesc> descs = {
+		{{shaders.begin(), shaders.end()}, pipeline_lt, rpass, settings}
+	};
+
+	// The instanced pipeline only reads positions from the unit quad,
+	// everything else comes from the instance streams
+	VkPipelineShaderStageCreateInfo instanced_vs{};
+	upload::Mesh unit_quad{};
+	if (opts.instanced) {
+		instanced_vs = ll::shader::create(base.device, VK_SHADER_STAGE_VERTEX_BIT,
+						  "shaders/instanced.vert.spv");
+		auto instanced_settings = ll::pipeline::PIPELINE_DEFAULTS;
+		instanced_settings.samples = samples;
+		instanced_settings.vertex_bindings = {ll::pipeline::vertex_binding(0, sizeof(Vertex))};
+		instanced_settings.vertex_attributes = {
+			ll::pipeline::vertex_attribute(0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, pos))
+		};
+		instancing::add_streams(instanced_settings, INSTANCE_STREAMS, 1, 1);
+		descs.push_back({{instanced_vs, fs}, pipeline_lt, rpass, instanced_settings});
+
+		std::vector<Vertex> quad_vertices = {
+			{{0.0F, 0.0F}, {}}, {{1.0F, 0.0F}, {}}, {{1.0F, 1.0F}, {}}, {{0.0F, 1.0F}, {}}
+		};
+		std::vector<uint32_t> quad_indices = {0, 1, 2, 2, 3, 0};
+		unit_quad = upload::mesh(allocator, base.device, base.queues.graphics,
+					 base.queue_fams.graphics.value(), quad_vertices, quad_indices);
+	}
+
+	auto batch = pipeline_batch::compile(pool, base.device, pipeline_cache, descs);
+	auto pipeline = batch.get(0);
+
+	std::unique_ptr<recorder::Recorder> slice_recorder;
+	if (opts.slice_ct > 0)
+		slice_recorder = std::make_unique<recorder::Recorder>(base.device, base.queue_fams.graphics.value(),
+								      FRAMES_IN_FLIGHT, pool, opts.slice_ct);
+
+	// With --async the culler's buffers live on the compute queue's
+	// family, apart from the draws handed to graphics every frame
+	auto graphics_fam = base.queue_fams.graphics.value();
+	auto cull_queue = base.queues.graphics;
+	auto cull_fam = graphics_fam;
+	std::unique_ptr<compute::AsyncQueue> async;
+	if (opts.async) {
+		if (base.queues.compute == VK_NULL_HANDLE) throw std::runtime_error("Device has no compute queue!");
+		cull_queue = base.queues.compute;
+		cull_fam = base.queue_fams.compute.value();
+		async = std::make_unique<compute::AsyncQueue>(base.device, cull_queue, cull_fam, FRAMES_IN_FLIGHT);
+		std::cout << "Culling on " << (base.queues.async_compute() ? "a separate" : "the graphics")
+			  << " queue" << std::endl;
+	}
+
+	std::unique_ptr<cull::Culler> culler;
+	VkPipelineShaderStageCreateInfo cull_cs{};
+	if (opts.cull) {
+		cull_cs = ll::shader::create(base.device, VK_SHADER_STAGE_COMPUTE_BIT, "shaders/cull.comp.spv");
+		culler = std::make_unique<cull::Culler>(allocator, base.phys_dev, base.device, cull_queue, cull_fam,
+							cull_cs, objects, FRAMES_IN_FLIGHT, pipeline_cache);
+	}
+
+	std::unique_ptr<instancing::Batcher> batcher;
+	if (opts.instanced)
+		batcher = std::make_unique<instancing::Batcher>(allocator, base.device, INSTANCE_STREAMS, 1,
+								FRAMES_IN_FLIGHT, opts.grid_size * opts.grid_size);
+
+	auto fb = ll::rpass::framebuffer(base.device, rpass, fb_views.size(), fb_views.data(), WIDTH, HEIGHT);
+
+	// Per-frame command buffers and fences
+	ll::cbuf::FrameAllocator cbuf_allocator(base.device, base.queue_fams.graphics.value(), FRAMES_IN_FLIGHT);
+	std::vector<VkFence> fences;
+	for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; ++i)
+		fences.push_back(ll::sync::fence(base.device, VK_FENCE_CREATE_SIGNALED_BIT));
+
+	ll::query::Profiler profiler(base.phys_dev, base.device, base.queue_fams.graphics.value(),
+				     FRAMES_IN_FLIGHT);
+
+	VkViewport viewport{0.0F, 0.0F, WIDTH, HEIGHT, 0.0F, 1.0F};
+	VkRect2D scissor{{0, 0}, {WIDTH, HEIGHT}};
+
+	timer::Timer timer;
+	for (uint32_t i = 0; i < opts.frame_ct; ++i) {
+		auto slot = i % FRAMES_IN_FLIGHT;
+
+		if (vkWaitForFences(base.device, 1, &fences[slot], VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+			throw std::runtime_error("Could not wait for frame's fence!");
+		if (vkResetFences(base.device, 1, &fences[slot]) != VK_SUCCESS)
+			throw std::runtime_error("Could not reset frame's fence!");
+
+		cbuf_allocator.begin_frame(slot);
+		if (slice_recorder) slice_recorder->begin_frame(slot);
+
+		// Every quad of the grid again, as one instance each. The
+		// batcher merges them into a single draw.
+		if (batcher) {
+			batcher->begin_frame(slot);
+			auto key = instancing::key(batch.get(1), unit_quad);
+			for (size_t q = 0; q < vertices.size(); q += 4) {
+				auto& top_left = vertices[q];
+				auto& bottom_right = vertices[q + 2];
+				std::array<float, 2> size = {bottom_right.pos[0] - top_left.pos[0],
+							     bottom_right.pos[1] - top_left.pos[1]};
+				batcher->add(key, {top_left.pos.data(), size.data(), top_left.color.data()});
+			}
+			batcher->prepare();
+		}
+
+		// The graphics submission below waits for this. Both queues are
+		// done with the slot's culling buffers, since the frame's
+		// fence covers the draws that read them last time.
+		uint64_t cull_value = 0;
+		if (async) {
+			cull_value = async->submit([&](VkCommandBuffer cull_cbuf) {
+				culler->cull(cull_cbuf, slot, cull::NDC_FRUSTUM);
+				if (cull_fam != graphics_fam) culler->release(cull_cbuf, slot, cull_fam, graphics_fam);
+			});
+		}
+
+		// One block per repeated draw, pushed here since the ring
+		// can't be shared between recording threads
+		std::vector<uint32_t> draw_offsets;
+		if (ring) {
+			ring->begin_frame(slot);
+			std::array<float, 2> offset = {0.0F, 0.0F};
+			for (uint32_t d = 0; d < opts.draw_ct; ++d) draw_offsets.push_back(ring->push(offset));
+			ring->flush();
+		}
+
+		auto cbuf = cbuf_allocator.get();
+		ll::cbuf::begin(cbuf, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		profiler.begin_frame(cbuf, slot);
+		auto record_draws = [&](VkCommandBuffer draw_cbuf, size_t begin, size_t end) {
+			ll::cbuf::set_viewport(draw_cbuf, {viewport});
+			ll::cbuf::set_scissor(draw_cbuf, {scissor});
+			// Both survive pipeline changes, since every pipeline has
+			// the same layout
+			if (table) {
+				table->bind(draw_cbuf, pipeline_lt);
+				std::array<uint32_t, 4> bindless_indices = {0, 0, tint_idx, 0};
+				ll::cbuf::push_constants(draw_cbuf, pipeline_lt, bindless::INDEX_PUSH_RANGE.stageFlags,
+							 bindless_indices);
+			}
+			if (batcher) {
+				for (size_t j = begin; j < end; ++j) batcher->record(draw_cbuf);
+				return;
+			}
+
+			ll::cbuf::bind_pipeline(draw_cbuf, pipeline);
+			ll::cbuf::bind_vertex_buffers(draw_cbuf, {grid.vertices.handle}, {0});
+			ll::cbuf::bind_index_buffer(draw_cbuf, grid.indices.handle);
+			for (size_t j = begin; j < end; ++j) {
+				if (ring) {
+					ll::cbuf::bind_descriptor_sets(draw_cbuf, pipeline_lt, {uniform_set},
+								       VK_PIPELINE_BIND_POINT_GRAPHICS, 0, {draw_offsets[j]});
+				}
+				if (culler) culler->draw(draw_cbuf, slot);
+				else ll::cbuf::draw_indexed(draw_cbuf, grid.index_ct);
+			}
+		};
+
+		if (async) {
+			if (cull_fam != graphics_fam) culler->acquire(cbuf, slot, cull_fam, graphics_fam);
+		} else if (culler) {
+			auto cull_scope = profiler.begin(cbuf, "cull");
+			culler->cull(cbuf, slot, cull::NDC_FRUSTUM);
+			profiler.end(cbuf, cull_scope);
+		}
+
+		auto scope = profiler.begin(cbuf, "main pass");
+		if (slice_recorder) {
+			ll::cbuf::begin_rpass(cbuf, rpass, fb, WIDTH, HEIGHT,
+					      VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			slice_recorder->record(cbuf, rpass, 0, fb, opts.draw_ct, record_draws);
+		} else {
+			ll::cbuf::begin_rpass(cbuf, rpass, fb, WIDTH, HEIGHT);
+			record_draws(cbuf, 0, opts.draw_ct);
+		}
+		ll::cbuf::end_rpass(cbuf);
+		profiler.end(cbuf, scope);
+		// Only the last frame is read back, so it doesn't skew the numbers
+		if (i == opts.frame_ct - 1) offscreen::record_readback(cbuf, target);
+		ll::cbuf::end(cbuf);
+
+		VkPipelineStageFlags cull_wait_stage = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+		VkTimelineSemaphoreSubmitInfo timeline_info{};
+		timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timeline_info.waitSemaphoreValueCount = 1;
+		timeline_info.pWaitSemaphoreValues = &cull_value;
+
+		VkSubmitInfo submit_info{};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &cbuf;
+		if (async) {
+			submit_info.pNext = &timeline_info;
+			submit_info.waitSemaphoreCount = 1;
+			submit_info.pWaitSemaphores = &async->timeline;
+			submit_info.pWaitDstStageMask = &cull_wait_stage;
+		}
+
+		if (vkQueueSubmit(base.queues.graphics, 1, &submit_info, fences[slot]) != VK_SUCCESS)
+			throw std::runtime_error("Could not submit!");
+		timer.frame();
+	}
+
+	if (vkWaitForFences(base.device, fences.size(), fences.data(), VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+		throw std::runtime_error("Could not wait for the last frames!");
+	timer.print_fps(opts.frame_ct);
+	timer.print_frame_stats();
+	if (!opts.stats.empty()) timer.write_frame_stats(opts.stats);
+	profiler.print_stats(std::cout);
+	allocator.print_stats(std::cout);
+
+	offscreen::invalidate(allocator, target);
+
+	auto status = 0;
+	if (!opts.out.empty()) offscreen::write_ppm(target, opts.out);
+	if (!opts.golden.empty()) {
+		auto mismatched = offscreen::compare_ppm(target, opts.golden, opts.tolerance);
+		std::cout << "Pixels differing from " << opts.golden << ": " << mismatched << std::endl;
+		if (mismatched != 0) status = 1;
+	}
+
+	// Cleanup
+	slice_recorder.reset();
+	async.reset();
+	culler.reset();
+	if (opts.cull) ll::shader::destroy(base.device, cull_cs);
+	batcher.reset();
+	ll::pipeline::save_cache(base.phys_dev, base.device, pipeline_cache, PIPELINE_CACHE_FILE);
+	vkDestroyPipelineCache(base.device, pipeline_cache, nullptr);
+
+	for (auto fence : fences) vkDestroyFence(base.device, fence, nullptr);
+
+	vkDestroyFramebuffer(base.device, fb, nullptr);
+	batch.destroy(base.device);
+	vkDestroyPipelineLayout(base.device, pipeline_lt, nullptr);
+	table.reset();
+	ring.reset();
+	if (opts.uniforms) {
+		vkDestroyDescriptorPool(base.device, uniform_pool, nullptr);
+		vkDestroyDescriptorSetLayout(base.device, uniform_set_lt, nullptr);
+	}
+	vkDestroyRenderPass(base.device, rpass, nullptr);
+
+	offscreen::destroy(allocator, base.device, target);
+	if (msaa_image != VK_NULL_HANDLE) {
+		vkDestroyImageView(base.device, msaa_view, nullptr);
+		vkDestroyImage(base.device, msaa_image, nullptr);
+		allocator.free(msaa_memory);
+	}
+	upload::destroy(allocator, base.device, grid);
+	if (opts.bindless) upload::destroy(allocator, base.device, tint);
+	if (opts.instanced) upload::destroy(allocator, base.device, unit_quad);
+
+	ll::shader::destroy(base.device, vs);
+	ll::shader::destroy(base.device, fs);
+	if (opts.instanced) ll::shader::destroy(base.device, instanced_vs);
+
+	return status;
+}
+
+auto main(int argc, char** argv) -> int {
+	try {
+		return run(parse_args(argc, argv));
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
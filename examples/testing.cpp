@@ -1,16 +1,21 @@
 #include "../src/base.hpp"
+#include "../src/graph.hpp"
 #include "../src/loop.hpp"
+#include "../src/upload.hpp"
 #include "../src/ll/device.hpp"
 #include "../src/ll/instance.hpp"
 #include "../src/ll/phys_dev.hpp"
 #include "../src/ll/queue.hpp"
 #include "../src/ll/swapchain.hpp"
 #include "../src/ll/image.hpp"
-#include "../src/ll/shader.hpp"
 #include "../src/ll/rpass.hpp"
+#include "../src/ll/shader.hpp"
 #include "../src/ll/pipeline.hpp"
 #include "../src/ll/cbuf.hpp"
+#include "../src/ll/descriptor.hpp"
 #include "../src/ll/sync.hpp"
+#include "../src/ll/query.hpp"
+#include "../src/ll/memory.hpp"
 #include "../src/timer.hpp"
 #include "../src/glfw_window.hpp"
 
@@ -20,257 +25,296 @@
 #include <stdexcept>
 #include <optional>
 #include <unordered_set>
+#include <memory>
 #include <algorithm>
 #include <fstream>
 #include <type_traits>
 #include <chrono>
 #include <array>
+#include <cstddef>
 
 const uint32_t INIT_WIDTH = 800, INIT_HEIGHT = 600;
+// Relative to the working directory, like the shaders
+const char* PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+// Lowered to whatever the device supports
+const VkSampleCountFlagBits MSAA_SAMPLES = VK_SAMPLE_COUNT_4_BIT;
+
+struct Vertex {
+	std::array<float, 2> pos;
+	std::array<float, 3> color;
+};
+
+// A quad, made up of two clockwise triangles
+const std::vector<Vertex> QUAD_VERTICES = {
+	{{-0.5F, -0.5F}, {1.0F, 0.0F, 0.0F}},
+	{{0.5F, -0.5F}, {0.0F, 1.0F, 0.0F}},
+	{{0.5F, 0.5F}, {0.0F, 0.0F, 1.0F}},
+	{{-0.5F, 0.5F}, {1.0F, 1.0F, 1.0F}}
+};
+const std::vector<uint32_t> QUAD_INDICES = {0, 1, 2, 2, 3, 0};
+
+// The vertex input comes from the vertex shader's reflection
+auto vertex_settings(VkSampleCountFlagBits samples, const ll::shader::VertexInput& input)
+	-> ll::pipeline::PipelineSettings
+{
+	auto settings = ll::pipeline::PIPELINE_DEFAULTS;
+	settings.samples = samples;
+	settings.depth_test = true;
+	settings.depth_write = true;
+	settings.vertex_bindings = input.bindings;
+	settings.vertex_attributes = input.attributes;
+	return settings;
+}
 
-const auto CBUF_CT = 4;
-
-void run() {
-	auto window = glfw_window::GWindow(INIT_WIDTH, INIT_HEIGHT);
-	// glfwSetFramebufferSizeCallback(window.window, resize_callback);
-
-	base::Base base(std::make_unique<base::Glfw>(window.req_instance_exts,
-						     std::vector<const char *>{VK_KHR_SWAPCHAIN_EXTENSION_NAME},
-						     window.window));
-
-	std::cout << "Using device: " << base.phys_dev_name << std::endl;
-
-	// Load shaders
-	auto vs = ll::shader::create(base.device, VK_SHADER_STAGE_VERTEX_BIT, "../shaders/shader.vert.spv");
-	auto fs = ll::shader::create(base.device, VK_SHADER_STAGE_FRAGMENT_BIT, "../shaders/shader.frag.spv");
+// Everything that has to be rebuilt when the swapchain changes
+struct Targets {
+	std::unique_ptr<graph::Graph> graph;
+	// Imported with no image, the acquired one is swapped in every frame
+	graph::Resource backbuffer = 0;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkViewport viewport{};
+	VkRect2D scissor{};
+};
 
-	std::array<VkPipelineShaderStageCreateInfo, 2> shaders = {vs, fs};
+void destroy_targets(VkDevice device, Targets& targets) {
+	targets.graph.reset();
 
-	auto pipeline_lt = ll::pipeline::layout(base.device);
+	if (targets.pipeline != VK_NULL_HANDLE) vkDestroyPipeline(device, targets.pipeline, nullptr);
+	targets.pipeline = VK_NULL_HANDLE;
+}
 
-	// Allocate command buffer
-	VkCommandPoolCreateInfo cpool_info{};
-	cpool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	cpool_info.queueFamilyIndex = base.queue_fams.graphics.value();
-	cpool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+struct Deps : loop::Dependencies {
+	Deps(const glfw_window::GWindow& window, const base::Base& base, ll::memory::Allocator& allocator,
+	     std::vector<ll::shader::Shader> shaders, ll::shader::VertexInput vertex_input,
+	     VkPipelineLayout pipeline_lt,
+	     VkPipelineCache pipeline_cache, ll::rpass::RpassCache& rpasses, ll::rpass::FramebufferCache& fbs,
+	     const upload::Mesh& quad, Targets& targets)
+		: window(window), base(base), allocator(allocator), shaders(std::move(shaders)),
+		  vertex_input(std::move(vertex_input)), pipeline_lt(pipeline_lt), pipeline_cache(pipeline_cache), rpasses(rpasses), fbs(fbs),
+		  quad(quad), targets(targets),
+		  samples(ll::image::max_samples(base.phys_dev, MSAA_SAMPLES)),
+		  depth_format(ll::image::depth_format(base.phys_dev)),
+		  dynamic_rendering(ll::phys_dev::dynamic_rendering(base.phys_dev)) {}
+
+	auto create_swapchain(const loop::Loop& loop) -> ll::swapchain::Swapchain override {
+		auto [width, height] = window.get_dims();
+		return ll::swapchain::create(base.phys_dev, base.device, base.surface,
+					     loop.swapchain.handle,
+					     base.queue_fams.unique.size(), base.queue_fams.unique.data(),
+					     width, height);
+	}
 
-	VkCommandPool cpool{};
-	if (vkCreateCommandPool(base.device, &cpool_info, nullptr, &cpool) != VK_SUCCESS)
-		throw std::runtime_error("Could not create command pool!");
+	void on_recreate(loop::Loop& loop, const ll::swapchain::Swapchain& old) override {
+		auto const& swapchain = loop.swapchain;
+
+		// The old graph's images and framebuffers might still be used
+		// by frames in flight. So might the framebuffers using the old
+		// swapchain's views, which go away once the loop retires it.
+		// With dynamic rendering, there are no framebuffers at all.
+		if (targets.graph) {
+			loop.retire([old_graph = std::shared_ptr<graph::Graph>(std::move(targets.graph))]() mutable {
+				old_graph.reset();
+			});
+		}
+		if (old.handle != VK_NULL_HANDLE) {
+			loop.retire([&fbs = fbs, views = old.image_views]() {
+				for (auto view : views) fbs.evict(view);
+			});
+		}
 
-	VkCommandBufferAllocateInfo cbuf_info{};
-	cbuf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	cbuf_info.commandPool = cpool;
-	cbuf_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	cbuf_info.commandBufferCount = CBUF_CT;
+		// Create graph, a single pass that draws the quad with depth
+		// testing. With MSAA, it draws into a multisampled image that
+		// is resolved into the swapchain image. The multisampled color
+		// and depth never leave the pass, so the graph makes them
+		// transient.
+		if (dynamic_rendering) targets.graph = std::make_unique<graph::Graph>(allocator, base.device);
+		else targets.graph = std::make_unique<graph::Graph>(allocator, base.device, rpasses, fbs);
+		targets.backbuffer = targets.graph->import_image(VK_NULL_HANDLE, VK_NULL_HANDLE,
+								 {swapchain.format, swapchain.width, swapchain.height},
+								 graph::ACQUIRED, graph::PRESENT);
+		auto depth = targets.graph->image({depth_format, swapchain.width, swapchain.height, samples});
+
+		graph::Pass main_pass;
+		main_pass.name = "main";
+		if (samples == VK_SAMPLE_COUNT_1_BIT) {
+			main_pass.colors = {{targets.backbuffer, VkClearValue{}}};
+		} else {
+			auto color = targets.graph->image({swapchain.format, swapchain.width, swapchain.height,
+							   samples});
+			main_pass.colors = {{color, VkClearValue{}}};
+			main_pass.resolves = {targets.backbuffer};
+		}
+		VkClearValue depth_clear{};
+		depth_clear.depthStencil = {1.0F, 0};
+		main_pass.depth = graph::Attachment{depth, depth_clear};
+		main_pass.record = [&targets = targets, &quad = quad](VkCommandBuffer cbuf) {
+			ll::cbuf::bind_pipeline(cbuf, targets.pipeline);
+			ll::cbuf::set_viewport(cbuf, {targets.viewport});
+			ll::cbuf::set_scissor(cbuf, {targets.scissor});
+			ll::cbuf::bind_vertex_buffers(cbuf, {quad.vertices.handle}, {0});
+			ll::cbuf::bind_index_buffer(cbuf, quad.indices.handle);
+			ll::cbuf::draw_indexed(cbuf, quad.index_ct);
+		};
+		auto main_idx = targets.graph->add_pass(std::move(main_pass));
+		targets.graph->compile();
+
+		// The pipeline only depends on the format (the viewport and
+		// scissor are dynamic), and so does the render pass the cache
+		// hands the graph, so a plain resize keeps both. With dynamic
+		// rendering it's built against the formats directly.
+		if (targets.pipeline == VK_NULL_HANDLE || old.format != swapchain.format) {
+			loop.retire([device = base.device, pipeline = targets.pipeline]() {
+				if (pipeline != VK_NULL_HANDLE) vkDestroyPipeline(device, pipeline, nullptr);
+			});
 
-	std::vector<VkCommandBuffer> cbufs(CBUF_CT);
-	if (vkAllocateCommandBuffers(base.device, &cbuf_info, cbufs.data()) != VK_SUCCESS)
-		throw std::runtime_error("Could not allocate command buffer!");
+			// Create pipeline
+			auto formats = targets.graph->formats(main_idx);
+			auto settings = vertex_settings(samples, vertex_input);
+			settings.color_ct = formats.colors.size();
+			if (dynamic_rendering) {
+				targets.pipeline = ll::pipeline::pipeline(base.device, shaders.size(), shaders.data(),
+									  pipeline_lt, formats, pipeline_cache, settings);
+			} else {
+				targets.pipeline = ll::pipeline::pipeline(base.device, shaders.size(), shaders.data(),
+									  pipeline_lt, targets.graph->rpass(main_idx),
+									  pipeline_cache, settings);
+			}
+		}
 
-	// Dynamic state (other fields will be filled in later)
-	VkViewport viewport{};
-	viewport.x = 0.0F;
-	viewport.y = 0.0F;
-	viewport.minDepth = 0.0F;
-	viewport.minDepth = 1.0F;
+		// Update dynamic state
+		targets.viewport.x = 0.0F;
+		targets.viewport.y = 0.0F;
+		targets.viewport.width = swapchain.width;
+		targets.viewport.height = swapchain.height;
+		targets.viewport.minDepth = 0.0F;
+		targets.viewport.maxDepth = 1.0F;
+		targets.scissor.offset = {0, 0};
+		targets.scissor.extent.width = swapchain.width;
+		targets.scissor.extent.height = swapchain.height;
+	}
 
-	VkRect2D scissor{};
-	scissor.offset = {0, 0};
+private:
+	const glfw_window::GWindow& window;
+	const base::Base& base;
+	ll::memory::Allocator& allocator;
+	std::vector<ll::shader::Shader> shaders;
+	ll::shader::VertexInput vertex_input;
+	VkPipelineLayout pipeline_lt;
+	VkPipelineCache pipeline_cache;
+	ll::rpass::RpassCache& rpasses;
+	ll::rpass::FramebufferCache& fbs;
+	const upload::Mesh& quad;
+	Targets& targets;
+	VkSampleCountFlagBits samples;
+	VkFormat depth_format;
+	// Falls back to render passes if the device doesn't have it
+	bool dynamic_rendering;
+};
 
-	// Synchronization
-	std::vector<VkSemaphore> image_avail_sems(CBUF_CT), render_done_sems(CBUF_CT);
-	std::vector<VkFence> render_done_fences(CBUF_CT);
+void run() {
+	auto window = glfw_window::GWindow(INIT_WIDTH, INIT_HEIGHT);
 
-	for (size_t i = 0; i < CBUF_CT; ++i) {
-		image_avail_sems[i] = ll::sync::semaphore(base.device);
-		render_done_sems[i] = ll::sync::semaphore(base.device);
-		render_done_fences[i] = ll::sync::fence(base.device, VK_FENCE_CREATE_SIGNALED_BIT);
-	}
+	base::Base base(std::make_unique<base::Glfw>(window.req_instance_exts,
+						     std::vector<const char *>{VK_KHR_SWAPCHAIN_EXTENSION_NAME},
+						     window.window));
 
-	// Everything from here on depends on the swapchain, so we make them
-	// null for now
-	auto swapchain = ll::swapchain::create(base.phys_dev, base.device, base.surface,
-					       VK_NULL_HANDLE,
-					       base.queue_fams.unique.size(), base.queue_fams.unique.data(),
-					       INIT_WIDTH, INIT_HEIGHT);
-	VkRenderPass rpass = VK_NULL_HANDLE;
-	VkPipeline pipeline = VK_NULL_HANDLE;
-	std::vector<VkFramebuffer> fbs;
-	std::vector<VkFence> image_fences;
+	std::cout << "Using device: " << base.phys_dev_name << std::endl;
+	if (ll::phys_dev::dynamic_rendering(base.phys_dev)) std::cout << "Using dynamic rendering" << std::endl;
 
-	auto sync_set_idx = 0;
+	// Load shaders
+	auto vs = ll::shader::create(base.device, VK_SHADER_STAGE_VERTEX_BIT, "shaders/mesh.vert.spv");
+	auto fs = ll::shader::create(base.device, VK_SHADER_STAGE_FRAGMENT_BIT, "shaders/mesh.frag.spv");
+
+	// The pipeline layout and vertex input are generated from the
+	// shaders, layouts are shared by every pipeline with the same
+	// interface
+	std::vector<ll::shader::Reflection> reflections = {ll::shader::reflect("shaders/mesh.vert.spv"),
+							   ll::shader::reflect("shaders/mesh.frag.spv")};
+	auto vertex_input = ll::shader::vertex_input(reflections[0]);
+	if (vertex_input.bindings.empty() || vertex_input.bindings[0].stride != sizeof(Vertex))
+		throw std::runtime_error("mesh.vert doesn't take Vertex as input!");
+	ll::descriptor::LayoutCache set_layouts(base.device);
+	ll::pipeline::LayoutCache pipeline_layouts(base.device);
+	auto pipeline_lt = pipeline_layouts.get(set_layouts, reflections);
+
+	// Geometry is streamed in on the transfer queue, if there is one, and
+	// picked up by the first frame
+	ll::memory::Allocator allocator(base.phys_dev, base.device);
+	auto graphics_fam = base.queue_fams.graphics.value();
+	auto has_transfer = base.queues.transfer != VK_NULL_HANDLE;
+	upload::Streamer streamer(allocator, base.device,
+				  has_transfer ? base.queues.transfer : base.queues.graphics,
+				  has_transfer ? base.queue_fams.transfer.value() : graphics_fam, graphics_fam);
+
+	VkDeviceSize vertices_size = QUAD_VERTICES.size() * sizeof(Vertex);
+	VkDeviceSize indices_size = QUAD_INDICES.size() * sizeof(uint32_t);
+	upload::Mesh quad{upload::create(allocator, base.device, vertices_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT),
+			  upload::create(allocator, base.device, indices_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT),
+			  static_cast<uint32_t>(QUAD_INDICES.size())};
+	streamer.upload(quad.vertices.handle, QUAD_VERTICES.data(), vertices_size);
+	streamer.upload(quad.indices.handle, QUAD_INDICES.data(), indices_size);
+	streamer.flush();
+	// Shared by every pipeline, including the ones rebuilt on format changes
+	auto pipeline_cache = ll::pipeline::load_cache(base.phys_dev, base.device, PIPELINE_CACHE_FILE);
+
+	// Outlive every graph, so resizing reuses the render pass
+	ll::rpass::RpassCache rpasses(base.device);
+	ll::rpass::FramebufferCache fbs(base.device);
+
+	Targets targets;
+	loop::Loop loop(std::make_unique<Deps>(window, base, allocator, std::vector<ll::shader::Shader>{vs, fs},
+					       vertex_input, pipeline_lt, pipeline_cache, rpasses, fbs, quad, targets),
+			base.device, base.queue_fams.graphics.value(), base.queues);
+
+	ll::query::Profiler profiler(base.phys_dev, base.device, base.queue_fams.graphics.value(), loop.frame_ct);
 
 	// Main loop
 	timer::Timer timer;
 	size_t frame_ct = 0;
-	auto must_recreate = true;
 
 	while (!glfwWindowShouldClose(window.window)) {
 		glfwPollEvents();
 
-		while (must_recreate) {
-			vkDeviceWaitIdle(base.device);
-			// Clean up old stuff
-			if (swapchain.handle != VK_NULL_HANDLE) ll::swapchain::destroy(base.device, swapchain);
-
-			// Create swapchain
-			auto [wwidth, wheight] = window.get_dims();
-			swapchain = ll::swapchain::create(base.phys_dev, base.device, base.surface,
-							  VK_NULL_HANDLE,
-							  base.queue_fams.unique.size(), base.queue_fams.unique.data(),
-							  wwidth, wheight);
-			auto [newwidth, newwheight] = window.get_dims();
-			if (newwidth != wwidth || newwheight != wheight) continue;
-
-			if (rpass != VK_NULL_HANDLE) vkDestroyRenderPass(base.device, rpass, nullptr);
-			if (pipeline != VK_NULL_HANDLE) vkDestroyPipeline(base.device, pipeline, nullptr);
-			if (!fbs.empty()) for (auto& i : fbs) vkDestroyFramebuffer(base.device, i, nullptr);
-
-			// Create render pass
-			auto color_attachment = ll::rpass::attachment(swapchain.format);
-			auto color_ref = ll::rpass::attachment_ref(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-			auto subpass = ll::rpass::subpass(1, &color_ref);
-			auto subpass_dep = ll::rpass::dependency();
-			rpass = ll::rpass::rpass(base.device, 1, &color_attachment, 1, &subpass, 1, &subpass_dep);
-
-			// Create pipeline
-			pipeline = ll::pipeline::pipeline(base.device, 2, shaders.data(), pipeline_lt, rpass);
-
-			// Create framebuffers
-			fbs.resize(swapchain.images.size());
-			for (size_t i = 0; i < swapchain.images.size(); ++i) {
-				auto view = swapchain.image_views[i];
-				
-				VkFramebufferCreateInfo info{};
-				info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-				info.renderPass = rpass;
-				info.attachmentCount = 1;
-				info.pAttachments = &view;
-				info.width = swapchain.width;
-				info.height = swapchain.height;
-				info.layers = 1;
-				
-				if (vkCreateFramebuffer(base.device, &info, nullptr, &fbs[i]) != VK_SUCCESS)
-					throw std::runtime_error("Could not create framebuffer!");
-			}
-
-			// Clear image fences
-			image_fences.clear();
-			image_fences.resize(swapchain.images.size(), VK_NULL_HANDLE);
+		auto drawn = loop.draw([&](const loop::Frame& frame) {
+			profiler.begin_frame(frame.cbuf, frame.frame_idx);
+			auto scope = profiler.begin(frame.cbuf, "main pass");
 
-			// Recreate fences and semaphores
-			for (size_t i = 0; i < CBUF_CT; ++i) {
-				vkDestroySemaphore(base.device, image_avail_sems[i], nullptr);
-				vkDestroySemaphore(base.device, render_done_sems[i], nullptr);
-				vkDestroyFence(base.device, render_done_fences[i], nullptr);
-
-				image_avail_sems[i] = ll::sync::semaphore(base.device);
-				render_done_sems[i] = ll::sync::semaphore(base.device);
-				render_done_fences[i] = ll::sync::fence(base.device, VK_FENCE_CREATE_SIGNALED_BIT);
-			}
+			// Take ownership of anything uploaded since the last frame
+			auto upload_sems = streamer.acquire(frame.cbuf, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+							    VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+			for (auto sem : upload_sems) loop.wait_for(sem, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+			if (!upload_sems.empty())
+				loop.retire([&streamer, upload_sems]() { streamer.recycle(upload_sems); });
 
+			targets.graph->set_image(targets.backbuffer, loop.swapchain.images[frame.image_idx],
+						 loop.swapchain.image_views[frame.image_idx]);
+			targets.graph->execute(frame.cbuf);
 
-			// Update dynamic state
-			viewport.width = swapchain.width;
-			viewport.height = swapchain.width;
-			scissor.extent.width = swapchain.width;
-			scissor.extent.height = swapchain.width;
+			profiler.end(frame.cbuf, scope);
+		});
 
-			must_recreate = false;
+		if (drawn) {
+			frame_ct++;
+			timer.frame();
 		}
-
-		// Wait for the sync set we'll use to become available
-		if (vkWaitForFences(base.device, 1, &render_done_fences[sync_set_idx], VK_TRUE, UINT64_MAX) != VK_SUCCESS)
-			throw std::runtime_error("Could not wait for sync set's render-done fence!");
-
-		auto cbuf = cbufs[sync_set_idx];
-		vkResetCommandBuffer(cbuf, 0);
-
-		uint32_t image_idx = 0;
-		if (vkAcquireNextImageKHR(base.device, swapchain.handle, UINT64_MAX,
-				      image_avail_sems[sync_set_idx], VK_NULL_HANDLE, &image_idx)
-		    != VK_SUCCESS) {
-			must_recreate = true;
-			continue;
-		}
-
-		// Wait for whoever's drawing to our image to finish
-		if (image_fences[image_idx] != VK_NULL_HANDLE)
-			if (vkWaitForFences(base.device, 1, &image_fences[image_idx], VK_TRUE, UINT64_MAX) != VK_SUCCESS)
-				throw std::runtime_error("Could not wait for image's fence!");
-
-		if (vkResetFences(base.device, 1, &render_done_fences[sync_set_idx]) != VK_SUCCESS)
-			throw std::runtime_error("Could not reset render-done fence!");
-
-		// We're now rendering to this image, so mark it with our fence
-		image_fences[image_idx] = render_done_fences[sync_set_idx];
-
-		ll::cbuf::begin(cbuf);
-		ll::cbuf::begin_rpass(cbuf, rpass, fbs[image_idx], swapchain.width, swapchain.height);
-		ll::cbuf::bind_pipeline(cbuf, pipeline);
-		ll::cbuf::set_viewport(cbuf, {viewport});
-		ll::cbuf::set_scissor(cbuf, {scissor});
-		ll::cbuf::draw(cbuf, 3);
-		ll::cbuf::end_rpass(cbuf);
-
-		VkSubmitInfo submit_info{};
-		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-		VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		submit_info.waitSemaphoreCount = 1;
-		submit_info.pWaitSemaphores = &image_avail_sems[sync_set_idx];
-		submit_info.pWaitDstStageMask = &wait_stage;
-		submit_info.commandBufferCount = 1;
-		submit_info.pCommandBuffers = &cbuf;
-		submit_info.signalSemaphoreCount = 1;
-		submit_info.pSignalSemaphores = &render_done_sems[sync_set_idx];
-
-		if (vkQueueSubmit(base.queues.graphics, 1, &submit_info, render_done_fences[sync_set_idx]) != VK_SUCCESS)
-			throw std::runtime_error("Could not submit!");
-
-		VkPresentInfoKHR present_info{};
-		present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-		present_info.waitSemaphoreCount = 1;
-		present_info.pWaitSemaphores = &render_done_sems[sync_set_idx];
-		present_info.swapchainCount = 1;
-		present_info.pSwapchains = &swapchain.handle;
-		present_info.pImageIndices = &image_idx;
-
-		auto res = vkQueuePresentKHR(base.queues.present, &present_info);
-		if (res == VK_ERROR_OUT_OF_DATE_KHR) {
-			must_recreate = true;
-		} else if (res != VK_SUCCESS)
-			throw std::runtime_error("Presenting failed with something other than out-of-date!");
-
-		frame_ct++;
-		sync_set_idx = (sync_set_idx+1)%CBUF_CT;
 	}
 
 	timer.print_fps(frame_ct);
+	timer.print_frame_stats();
+	profiler.print_stats(std::cout);
 
-	vkQueueWaitIdle(base.queues.graphics);
-	vkQueueWaitIdle(base.queues.present);
-
-	// Cleanup
-	for (size_t i = 0; i < CBUF_CT; ++i) {
-		vkDestroySemaphore(base.device, image_avail_sems[i], nullptr);
-		vkDestroySemaphore(base.device, render_done_sems[i], nullptr);
-		vkDestroyFence(base.device, render_done_fences[i], nullptr);
-	}
+	// Cleanup, the loop itself is destroyed at the end of the scope
+	vkDeviceWaitIdle(base.device);
 
-	vkDestroyCommandPool(base.device, cpool, nullptr);
+	destroy_targets(base.device, targets);
+	for (auto view : loop.swapchain.image_views) fbs.evict(view);
+	upload::destroy(allocator, base.device, quad);
 
-	vkDestroyPipeline(base.device, pipeline, nullptr);
-	vkDestroyPipelineLayout(base.device, pipeline_lt, nullptr);
-	vkDestroyRenderPass(base.device, rpass, nullptr);
+	ll::pipeline::save_cache(base.phys_dev, base.device, pipeline_cache, PIPELINE_CACHE_FILE);
+	vkDestroyPipelineCache(base.device, pipeline_cache, nullptr);
 
 	ll::shader::destroy(base.device, vs);
 	ll::shader::destroy(base.device, fs);
-
-	for (auto& i : fbs) vkDestroyFramebuffer(base.device, i, nullptr);
-
-	ll::swapchain::destroy(base.device, swapchain);
 }
 
 auto main() -> int {
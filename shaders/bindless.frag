@@ -0,0 +1,17 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+#extension GL_GOOGLE_include_directive : require
+
+#include "bindless.glsl"
+
+layout(location = 0) in vec3 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	// The draw's tint, three floats in the buffer it picked
+	vec3 tint = uintBitsToFloat(uvec3(bindlessBuffers[indices.bufferIdx].data[0],
+					  bindlessBuffers[indices.bufferIdx].data[1],
+					  bindlessBuffers[indices.bufferIdx].data[2]));
+	outColor = vec4(fragColor * tint, 1.0);
+}
@@ -0,0 +1,19 @@
+// Declarations matching bindless::Table, include after
+// #extension GL_EXT_nonuniform_qualifier : require
+// and wrap indices that differ within a draw in nonuniformEXT().
+
+layout(set = 0, binding = 0) uniform texture2D bindlessImages[];
+layout(set = 0, binding = 1) uniform sampler bindlessSamplers[];
+layout(std430, set = 0, binding = 2) readonly buffer BindlessBuffer { uint data[]; } bindlessBuffers[];
+
+// Matches bindless::INDEX_PUSH_RANGE
+layout(push_constant) uniform BindlessIndices {
+	uint imageIdx;
+	uint samplerIdx;
+	uint bufferIdx;
+	uint extra;
+} indices;
+
+vec4 bindlessSample(uint imageIdx, uint samplerIdx, vec2 uv) {
+	return texture(sampler2D(bindlessImages[nonuniformEXT(imageIdx)], bindlessSamplers[nonuniformEXT(samplerIdx)]), uv);
+}
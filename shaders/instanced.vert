@@ -0,0 +1,16 @@
+#version 450
+
+// Unit quad, from 0 to 1
+layout(location = 0) in vec2 inPosition;
+
+// Per instance, one stream each
+layout(location = 1) in vec2 inOffset;
+layout(location = 2) in vec2 inSize;
+layout(location = 3) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+	gl_Position = vec4(inOffset + inPosition * inSize, 0.0, 1.0);
+	fragColor = inColor;
+}
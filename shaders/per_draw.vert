@@ -0,0 +1,16 @@
+#version 450
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+// Per draw, picked from a uniform_ring::Ring with a dynamic offset
+layout(set = 0, binding = 0) uniform Draw {
+	vec2 offset;
+} draw;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+	gl_Position = vec4(inPosition + draw.offset, 0.0, 1.0);
+	fragColor = inColor;
+}
@@ -70,12 +70,51 @@ namespace base {
 	}
 
 	auto Default::create_device(const Base& base) -> VkDevice {
-		// The device has to support all our different queue families
-		auto dev_queue_infos = ll::device::default_queue_infos(base.queue_fams.unique.begin(),
-								      base.queue_fams.unique.end());
+		// The device has to support all our different queue families,
+		// with a second graphics queue for async compute if needed
+		auto fams = base.queue_fams.device_queues();
+		auto dev_queue_infos = ll::device::default_queue_infos(fams.begin(), fams.end());
+
+		// Frame synchronization is built on timeline semaphores
+		VkPhysicalDeviceVulkan12Features supported12{};
+		supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 supported{};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(base.phys_dev, &supported);
+		if (!supported12.timelineSemaphore)
+			throw std::runtime_error("Timeline semaphores not supported!");
+
+		VkPhysicalDeviceVulkan12Features features12{};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		features12.timelineSemaphore = VK_TRUE;
+
+		// Optional, for GPU-driven drawing. Whoever uses them should
+		// check for support the same way.
+		VkPhysicalDeviceFeatures features{};
+		features.multiDrawIndirect = supported.features.multiDrawIndirect;
+		features12.drawIndirectCount = supported12.drawIndirectCount;
+		// Descriptor indexing, for bindless::Table
+		features12.descriptorIndexing = supported12.descriptorIndexing;
+		features12.runtimeDescriptorArray = supported12.runtimeDescriptorArray;
+		features12.descriptorBindingPartiallyBound = supported12.descriptorBindingPartiallyBound;
+		features12.descriptorBindingUpdateUnusedWhilePending = supported12.descriptorBindingUpdateUnusedWhilePending;
+		features12.descriptorBindingSampledImageUpdateAfterBind =
+			supported12.descriptorBindingSampledImageUpdateAfterBind;
+		features12.descriptorBindingStorageBufferUpdateAfterBind =
+			supported12.descriptorBindingStorageBufferUpdateAfterBind;
+		features12.shaderSampledImageArrayNonUniformIndexing = supported12.shaderSampledImageArrayNonUniformIndexing;
+		features12.shaderStorageBufferArrayNonUniformIndexing = supported12.shaderStorageBufferArrayNonUniformIndexing;
+
+		// Dynamic rendering, for graph::Graph and pipelines that aren't
+		// tied to render passes
+		VkPhysicalDeviceVulkan13Features features13{};
+		features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+		features13.dynamicRendering = ll::phys_dev::dynamic_rendering(base.phys_dev);
+		if (features13.dynamicRendering) features12.pNext = &features13;
 
 		VkDevice device{};
-		ll::device::create(base.phys_dev, dev_queue_infos, {}, device_exts, &device);
+		ll::device::create(base.phys_dev, dev_queue_infos, features, device_exts, &device, &features12);
 
 		return device;
 	}
@@ -0,0 +1,137 @@
+#include "bindless.hpp"
+
+#include "ll/cbuf.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace bindless {
+	auto supported(VkPhysicalDevice phys_dev) -> bool {
+		VkPhysicalDeviceVulkan12Features features12{};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &features12;
+		vkGetPhysicalDeviceFeatures2(phys_dev, &features);
+
+		return features12.descriptorIndexing
+			&& features12.runtimeDescriptorArray
+			&& features12.descriptorBindingPartiallyBound
+			&& features12.descriptorBindingUpdateUnusedWhilePending
+			&& features12.descriptorBindingSampledImageUpdateAfterBind
+			&& features12.descriptorBindingStorageBufferUpdateAfterBind
+			&& features12.shaderSampledImageArrayNonUniformIndexing
+			&& features12.shaderStorageBufferArrayNonUniformIndexing;
+	}
+
+	auto Table::Slots::take() -> uint32_t {
+		if (!free.empty()) {
+			auto idx = free.back();
+			free.pop_back();
+			return idx;
+		}
+		if (next == capacity) throw std::runtime_error("Bindless table is full!");
+
+		return next++;
+	}
+
+	void Table::Slots::give_back(uint32_t idx) {
+		if (idx >= next) throw std::runtime_error("Bindless index was never handed out!");
+		free.push_back(idx);
+	}
+
+	Table::Table(VkPhysicalDevice phys_dev, VkDevice device, Capacities capacities) : device(device) {
+		if (!supported(phys_dev)) throw std::runtime_error("Descriptor indexing not supported!");
+
+		VkPhysicalDeviceDescriptorIndexingProperties indexing_props{};
+		indexing_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+		VkPhysicalDeviceProperties2 props{};
+		props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		props.pNext = &indexing_props;
+		vkGetPhysicalDeviceProperties2(phys_dev, &props);
+
+		// Every stage can see the whole table, so the per-stage
+		// limits apply too
+		images.capacity = std::min({capacities.images,
+					    indexing_props.maxDescriptorSetUpdateAfterBindSampledImages,
+					    indexing_props.maxPerStageDescriptorUpdateAfterBindSampledImages});
+		samplers.capacity = std::min({capacities.samplers,
+					      indexing_props.maxDescriptorSetUpdateAfterBindSamplers,
+					      indexing_props.maxPerStageDescriptorUpdateAfterBindSamplers});
+		buffers.capacity = std::min({capacities.buffers,
+					     indexing_props.maxDescriptorSetUpdateAfterBindStorageBuffers,
+					     indexing_props.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+
+		std::vector<VkDescriptorSetLayoutBinding> bindings = {
+			ll::descriptor::binding(IMAGE_BINDING, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+						VK_SHADER_STAGE_ALL, images.capacity),
+			ll::descriptor::binding(SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_SAMPLER,
+						VK_SHADER_STAGE_ALL, samplers.capacity),
+			ll::descriptor::binding(BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+						VK_SHADER_STAGE_ALL, buffers.capacity)
+		};
+		VkDescriptorBindingFlags binding_flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+			| VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+			| VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+		set_layout = ll::descriptor::layout(device, bindings,
+						    VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+						    std::vector<VkDescriptorBindingFlags>(bindings.size(), binding_flags));
+
+		pool = ll::descriptor::pool(device, 1, {
+			{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, images.capacity},
+			{VK_DESCRIPTOR_TYPE_SAMPLER, samplers.capacity},
+			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers.capacity}
+		}, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
+		set = ll::descriptor::allocate(device, pool, set_layout);
+	}
+
+	Table::~Table() {
+		vkDestroyDescriptorPool(device, pool, nullptr);
+		vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+	}
+
+	auto Table::add_image(VkImageView view, VkImageLayout layout) -> uint32_t {
+		auto idx = images.take();
+		writer.image(set, IMAGE_BINDING, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_NULL_HANDLE, view, layout, idx);
+		return idx;
+	}
+
+	auto Table::add_sampler(VkSampler sampler) -> uint32_t {
+		auto idx = samplers.take();
+		writer.image(set, SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_SAMPLER, sampler, VK_NULL_HANDLE,
+			     VK_IMAGE_LAYOUT_UNDEFINED, idx);
+		return idx;
+	}
+
+	auto Table::add_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) -> uint32_t {
+		auto idx = buffers.take();
+		writer.buffer(set, BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffer, offset, range, idx);
+		return idx;
+	}
+
+	void Table::remove_image(uint32_t idx) {
+		images.give_back(idx);
+	}
+
+	void Table::remove_sampler(uint32_t idx) {
+		samplers.give_back(idx);
+	}
+
+	void Table::remove_buffer(uint32_t idx) {
+		buffers.give_back(idx);
+	}
+
+	void Table::flush() {
+		writer.flush(device);
+	}
+
+	void Table::bind(VkCommandBuffer cbuf, VkPipelineLayout pipeline_layout,
+			 VkPipelineBindPoint point, uint32_t set_idx) const
+	{
+		ll::cbuf::bind_descriptor_sets(cbuf, pipeline_layout, {set}, point, set_idx);
+	}
+
+	auto Table::capacities() const -> Capacities {
+		return {images.capacity, samplers.capacity, buffers.capacity};
+	}
+}
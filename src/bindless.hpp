@@ -0,0 +1,108 @@
+#ifndef BINDLESS_H
+#define BINDLESS_H
+
+#include "ll/descriptor.hpp"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+namespace bindless {
+	// Where each array lives in the table's set, see shaders/bindless.glsl
+	const uint32_t IMAGE_BINDING = 0;
+	const uint32_t SAMPLER_BINDING = 1;
+	const uint32_t BUFFER_BINDING = 2;
+
+	// Shaders pick their resources with indices passed as push
+	// constants, in this range. Add it to the pipeline layout.
+	const VkPushConstantRange INDEX_PUSH_RANGE {
+		VK_SHADER_STAGE_ALL, // stageFlags
+		0, // offset
+		16 // size, four uints
+	};
+
+	struct Capacities {
+		uint32_t images;
+		uint32_t samplers;
+		uint32_t buffers;
+	};
+
+	// Clamped to the device's limits
+	const Capacities DEFAULT_CAPACITIES {
+		16384, // images
+		256, // samplers
+		16384 // buffers
+	};
+
+	// Whether the device has the descriptor indexing features Table
+	// needs. Base::Default enables all of them that are supported.
+	auto supported(VkPhysicalDevice phys_dev) -> bool;
+
+	// One global descriptor set holding arrays of sampled images,
+	// samplers and storage buffers, which shaders index into. It is bound
+	// once per command buffer instead of per draw, so draws with
+	// different materials can go into one indirect draw.
+	//
+	// The arrays are partially bound, so unused entries can hold
+	// anything, and update-after-bind, so resources can be added while
+	// command buffers using the table are recorded or even executing
+	// (as long as they don't use the entries being written). Writes are
+	// batched until flush(), which has to come before the next submit.
+	//
+	// Not thread-safe.
+	struct Table {
+		// Goes into pipeline layouts next to INDEX_PUSH_RANGE, usually
+		// as set 0
+		VkDescriptorSetLayout set_layout = VK_NULL_HANDLE;
+
+		Table(VkPhysicalDevice phys_dev, VkDevice device, Capacities capacities = DEFAULT_CAPACITIES);
+		~Table();
+
+		Table(const Table&) = delete;
+		auto operator=(const Table&) -> Table& = delete;
+
+		// Return the index shaders use. Throw once the array is full.
+		auto add_image(VkImageView view,
+			       VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) -> uint32_t;
+		auto add_sampler(VkSampler sampler) -> uint32_t;
+		auto add_buffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE)
+			-> uint32_t;
+
+		// The index will be handed out again, so only remove entries
+		// once no submitted work uses them, e.g. from
+		// loop::Loop::retire()
+		void remove_image(uint32_t idx);
+		void remove_sampler(uint32_t idx);
+		void remove_buffer(uint32_t idx);
+
+		// Writes every entry added since the last flush
+		void flush();
+
+		void bind(VkCommandBuffer cbuf, VkPipelineLayout pipeline_layout,
+			  VkPipelineBindPoint point = VK_PIPELINE_BIND_POINT_GRAPHICS, uint32_t set_idx = 0) const;
+
+		auto capacities() const -> Capacities;
+
+	private:
+		// Hands out indices into one of the arrays
+		struct Slots {
+			uint32_t capacity;
+			uint32_t next = 0;
+			std::vector<uint32_t> free;
+
+			auto take() -> uint32_t;
+			void give_back(uint32_t idx);
+		};
+
+		VkDevice device;
+		VkDescriptorPool pool = VK_NULL_HANDLE;
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		ll::descriptor::Writer writer;
+
+		Slots images;
+		Slots samplers;
+		Slots buffers;
+	};
+}
+
+#endif // BINDLESS_H
@@ -0,0 +1,77 @@
+#include "compute.hpp"
+
+#include "ll/sync.hpp"
+
+#include <stdexcept>
+
+namespace compute {
+	AsyncQueue::AsyncQueue(VkDevice device, VkQueue queue, uint32_t queue_fam, uint32_t submit_ct)
+		: device(device), queue(queue), cbuf_allocator(device, queue_fam, submit_ct)
+	{
+		timeline = ll::sync::timeline(device);
+		slot_values.resize(submit_ct, 0);
+	}
+
+	AsyncQueue::~AsyncQueue() {
+		wait(last_value);
+		vkDestroySemaphore(device, timeline, nullptr);
+	}
+
+	void AsyncQueue::wait_for(VkSemaphore sem, VkPipelineStageFlags stage, uint64_t value) {
+		wait_sems.push_back(sem);
+		wait_stages.push_back(stage);
+		wait_values.push_back(value);
+	}
+
+	auto AsyncQueue::submit(const RecordFn& record) -> uint64_t {
+		// The slot's command pool can only be reset once its last
+		// submission is done
+		wait(slot_values[slot_idx]);
+		cbuf_allocator.begin_frame(slot_idx);
+
+		auto cbuf = cbuf_allocator.get();
+		ll::cbuf::begin(cbuf, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		record(cbuf);
+		ll::cbuf::end(cbuf);
+
+		auto value = last_value + 1;
+
+		VkTimelineSemaphoreSubmitInfo timeline_info{};
+		timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timeline_info.waitSemaphoreValueCount = wait_values.size();
+		timeline_info.pWaitSemaphoreValues = wait_values.data();
+		timeline_info.signalSemaphoreValueCount = 1;
+		timeline_info.pSignalSemaphoreValues = &value;
+
+		VkSubmitInfo submit_info{};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.pNext = &timeline_info;
+		submit_info.waitSemaphoreCount = wait_sems.size();
+		submit_info.pWaitSemaphores = wait_sems.data();
+		submit_info.pWaitDstStageMask = wait_stages.data();
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &cbuf;
+		submit_info.signalSemaphoreCount = 1;
+		submit_info.pSignalSemaphores = &timeline;
+
+		if (vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+			throw std::runtime_error("Could not submit compute work!");
+		wait_sems.clear();
+		wait_stages.clear();
+		wait_values.clear();
+
+		last_value = value;
+		slot_values[slot_idx] = value;
+		slot_idx = (slot_idx + 1) % slot_values.size();
+
+		return value;
+	}
+
+	auto AsyncQueue::completed() const -> uint64_t {
+		return ll::sync::value(device, timeline);
+	}
+
+	void AsyncQueue::wait(uint64_t value) const {
+		ll::sync::wait(device, timeline, value);
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef COMPUTE_H
+#define COMPUTE_H
+
+#include "ll/cbuf.hpp"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace compute {
+	const uint32_t DEFAULT_SUBMITS_IN_FLIGHT = 2;
+
+	// Records into cbuf, which has already been begun and will be ended
+	// and submitted afterwards
+	using RecordFn = std::function<void(VkCommandBuffer cbuf)>;
+
+	// Submits work to a compute queue so it can run alongside the
+	// graphics queue (see ll::queue::Queues::async_compute()).
+	//
+	// Every submission signals the next value of timeline, which is how
+	// the other queues wait for it, e.g. with loop::Loop::wait_for(). The
+	// other way around, wait_for() takes loop::Loop::timeline and its
+	// current_value(). Timeline waits may be submitted before the
+	// matching signal, so the order the two queues are fed in doesn't
+	// matter.
+	//
+	// Resources used by both queues either need VK_SHARING_MODE_CONCURRENT
+	// or queue family ownership transfers if the families differ.
+	//
+	// Not thread-safe.
+	struct AsyncQueue {
+		// Signalled by every submission, with values counting up from 1
+		VkSemaphore timeline = VK_NULL_HANDLE;
+
+		AsyncQueue(VkDevice device, VkQueue queue, uint32_t queue_fam,
+			   uint32_t submit_ct = DEFAULT_SUBMITS_IN_FLIGHT);
+		~AsyncQueue();
+
+		AsyncQueue(const AsyncQueue&) = delete;
+		auto operator=(const AsyncQueue&) -> AsyncQueue& = delete;
+
+		// Makes the next submission wait on sem at stage. Value is only
+		// used for timeline semaphores.
+		void wait_for(VkSemaphore sem, VkPipelineStageFlags stage, uint64_t value = 0);
+
+		// Records and submits one command buffer, returning the
+		// timeline value it will signal. Blocks if submit_ct
+		// submissions are already in flight.
+		auto submit(const RecordFn& record) -> uint64_t;
+
+		// The value of the latest finished submission
+		auto completed() const -> uint64_t;
+
+		// Blocks until the submission that returned value is done
+		void wait(uint64_t value) const;
+
+	private:
+		VkDevice device;
+		VkQueue queue;
+		ll::cbuf::FrameAllocator cbuf_allocator;
+
+		// The timeline value of each slot's last submission (or 0)
+		std::vector<uint64_t> slot_values;
+		uint32_t slot_idx = 0;
+		uint64_t last_value = 0;
+
+		std::vector<VkSemaphore> wait_sems;
+		std::vector<VkPipelineStageFlags> wait_stages;
+		std::vector<uint64_t> wait_values;
+	};
+}
+
+#endif // COMPUTE_H
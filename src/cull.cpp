@@ -0,0 +1,159 @@
+#include "cull.hpp"
+
+#include "ll/buffer.hpp"
+#include "ll/cbuf.hpp"
+#include "ll/descriptor.hpp"
+#include "ll/pipeline.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace cull {
+	const uint32_t BINDING_CT = 4;
+
+	Culler::Culler(ll::memory::Allocator& allocator, VkPhysicalDevice phys_dev, VkDevice device,
+		       VkQueue queue, uint32_t queue_fam, const VkPipelineShaderStageCreateInfo& shader,
+		       const std::vector<Object>& objects, uint32_t frame_ct, VkPipelineCache cache)
+		: allocator(allocator), device(device), obj_ct(objects.size())
+	{
+		if (objects.empty()) throw std::runtime_error("Nothing to cull!");
+
+		VkPhysicalDeviceVulkan12Features supported12{};
+		supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 supported{};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(phys_dev, &supported);
+		// Without it every object would need its own draw call
+		if (supported.features.multiDrawIndirect != VK_TRUE)
+			throw std::runtime_error("Culling needs multiDrawIndirect!");
+		indirect_count = supported12.drawIndirectCount == VK_TRUE;
+
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(phys_dev, &props);
+		if (obj_ct > props.limits.maxDrawIndirectCount)
+			throw std::runtime_error("Too many objects for one indirect draw!");
+
+		object_buf = upload::buffers(allocator, device, queue, queue_fam,
+					  {{objects.data(), objects.size() * sizeof(Object),
+					    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT}},
+					  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT)[0];
+
+		// Descriptors: params, objects, draws, count
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		for (uint32_t i = 0; i < BINDING_CT; ++i) {
+			auto type = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings.push_back(ll::descriptor::binding(i, type, VK_SHADER_STAGE_COMPUTE_BIT));
+		}
+		set_layout = ll::descriptor::layout(device, bindings);
+		desc_pool = ll::descriptor::pool(device, frame_ct, {
+			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frame_ct},
+			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame_ct * (BINDING_CT - 1)}
+		});
+
+		ll::descriptor::Writer writer;
+		for (uint32_t i = 0; i < frame_ct; ++i) {
+			Slot slot{};
+
+			// Rewritten by the CPU every frame, so keep it mapped
+			slot.params = ll::buffer::create(device, sizeof(Params), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+			slot.params_memory = allocator.bind(slot.params, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+							    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			slot.draws = upload::create(allocator, device, obj_ct * sizeof(VkDrawIndexedIndirectCommand),
+						    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+			slot.count = upload::create(allocator, device, sizeof(uint32_t),
+						    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+			slot.set = ll::descriptor::allocate(device, desc_pool, set_layout);
+
+			writer.buffer(slot.set, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, slot.params, 0, sizeof(Params));
+			writer.buffer(slot.set, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, object_buf.handle);
+			writer.buffer(slot.set, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, slot.draws.handle);
+			writer.buffer(slot.set, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, slot.count.handle);
+
+			slots.push_back(slot);
+		}
+		writer.flush(device);
+
+		pipeline_layout = ll::pipeline::layout(device, {set_layout});
+		pipeline = ll::pipeline::compute(device, shader, pipeline_layout, cache);
+	}
+
+	Culler::~Culler() {
+		vkDestroyPipeline(device, pipeline, nullptr);
+		vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+		vkDestroyDescriptorPool(device, desc_pool, nullptr);
+		vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+
+		for (const auto& slot : slots) {
+			vkDestroyBuffer(device, slot.params, nullptr);
+			allocator.free(slot.params_memory);
+			upload::destroy(allocator, device, slot.draws);
+			upload::destroy(allocator, device, slot.count);
+		}
+		upload::destroy(allocator, device, object_buf);
+	}
+
+	auto Culler::object_ct() const -> uint32_t {
+		return obj_ct;
+	}
+
+	void Culler::cull(VkCommandBuffer cbuf, uint32_t frame_idx, const Frustum& frustum) {
+		auto& slot = slots[frame_idx];
+
+		// The slot's last draw() has finished by the time the frame
+		// comes around again, so the CPU can overwrite this right away
+		Params params{frustum, obj_ct, indirect_count ? 1U : 0U};
+		std::memcpy(slot.params_memory.mapped, &params, sizeof(params));
+		allocator.flush(slot.params_memory);
+
+		if (indirect_count) {
+			vkCmdFillBuffer(cbuf, slot.count.handle, 0, sizeof(uint32_t), 0);
+			ll::buffer::barrier(cbuf, slot.count.handle,
+					    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+					    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+					    VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+		}
+
+		ll::cbuf::bind_pipeline(cbuf, pipeline, VK_PIPELINE_BIND_POINT_COMPUTE);
+		ll::cbuf::bind_descriptor_sets(cbuf, pipeline_layout, {slot.set}, VK_PIPELINE_BIND_POINT_COMPUTE);
+		ll::cbuf::dispatch(cbuf, ll::cbuf::group_ct(obj_ct, GROUP_SIZE));
+
+		ll::cbuf::memory_barrier(cbuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+					 VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+	}
+
+	// Culling rewrites the whole slot every frame, so it never needs the
+	// buffers handed back
+	void Culler::release(VkCommandBuffer cbuf, uint32_t frame_idx, uint32_t src_fam, uint32_t dst_fam) const {
+		const auto& slot = slots[frame_idx];
+
+		ll::buffer::release(cbuf, slot.draws.handle, src_fam, dst_fam,
+				    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+		if (indirect_count) {
+			ll::buffer::release(cbuf, slot.count.handle, src_fam, dst_fam,
+					    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+		}
+	}
+
+	void Culler::acquire(VkCommandBuffer cbuf, uint32_t frame_idx, uint32_t src_fam, uint32_t dst_fam) const {
+		const auto& slot = slots[frame_idx];
+
+		ll::buffer::acquire(cbuf, slot.draws.handle, src_fam, dst_fam,
+				    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+		if (indirect_count) {
+			ll::buffer::acquire(cbuf, slot.count.handle, src_fam, dst_fam,
+					    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+		}
+	}
+
+	void Culler::draw(VkCommandBuffer cbuf, uint32_t frame_idx) const {
+		const auto& slot = slots[frame_idx];
+
+		// Without a count, every object's draw is issued and the
+		// culled ones draw zero instances
+		if (indirect_count)
+			ll::cbuf::draw_indexed_indirect_count(cbuf, slot.draws.handle, 0, slot.count.handle, 0, obj_ct);
+		else
+			ll::cbuf::draw_indexed_indirect(cbuf, slot.draws.handle, 0, obj_ct);
+	}
+}
@@ -0,0 +1,118 @@
+#ifndef CULL_H
+#define CULL_H
+
+#include "ll/memory.hpp"
+#include "upload.hpp"
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace cull {
+	// Has to match local_size_x in cull.comp
+	const uint32_t GROUP_SIZE = 64;
+
+	// One drawable thing and its bounding sphere. Same layout as Object
+	// in cull.comp (std430).
+	struct Object {
+		std::array<float, 3> center;
+		float radius;
+		uint32_t index_ct;
+		uint32_t first_index;
+		int32_t vertex_offset;
+		uint32_t first_instance;
+	};
+
+	// Six planes (a, b, c, d), a point is inside if a*x + b*y + c*z + d
+	// >= 0 for all of them. Unused planes can be left all-zero.
+	using Frustum = std::array<std::array<float, 4>, 6>;
+
+	// Clip space, so objects given in normalized device coordinates are
+	// kept if they overlap the viewport
+	const Frustum NDC_FRUSTUM {{
+		{1.0F, 0.0F, 0.0F, 1.0F}, // left
+		{-1.0F, 0.0F, 0.0F, 1.0F}, // right
+		{0.0F, 1.0F, 0.0F, 1.0F}, // top
+		{0.0F, -1.0F, 0.0F, 1.0F}, // bottom
+		{0.0F, 0.0F, 1.0F, 0.0F}, // near
+		{0.0F, 0.0F, -1.0F, 1.0F} // far
+	}};
+
+	// Culls a fixed list of objects against a frustum with a compute
+	// shader (cull.comp) and turns the survivors into indexed indirect
+	// draws, so the CPU records the same two commands no matter how many
+	// objects there are.
+	//
+	// If the device has drawIndirectCount, the visible draws are packed
+	// and counted on the GPU. Otherwise every object keeps its draw and
+	// culled ones get an instance count of zero. Either way it's one
+	// indirect draw, so the device needs multiDrawIndirect enabled (and
+	// drawIndirectCount when it's supported), like base::Default does.
+	//
+	// Every frame in flight has its own output buffers, so cull() for one
+	// frame doesn't have to wait for another frame's draw().
+	struct Culler {
+		// Objects are uploaded once through queue, shader is cull.comp.
+		// All objects have to use the same vertex and index buffers.
+		// Throws if the device doesn't support multiDrawIndirect.
+		Culler(ll::memory::Allocator& allocator, VkPhysicalDevice phys_dev, VkDevice device,
+		       VkQueue queue, uint32_t queue_fam, const VkPipelineShaderStageCreateInfo& shader,
+		       const std::vector<Object>& objects, uint32_t frame_ct,
+		       VkPipelineCache cache = VK_NULL_HANDLE);
+		~Culler();
+
+		Culler(const Culler&) = delete;
+		auto operator=(const Culler&) -> Culler& = delete;
+
+		// Records the culling pass, outside of any render pass. The
+		// draws are ready for draw() afterwards.
+		void cull(VkCommandBuffer cbuf, uint32_t frame_idx, const Frustum& frustum);
+
+		// For cull() and draw() on queues of different families, e.g.
+		// async compute and graphics: hands the frame's draws from
+		// src_fam to dst_fam. Release goes after cull() on the culling
+		// queue, acquire before the render pass on the drawing queue,
+		// and a semaphore has to order the two submissions.
+		void release(VkCommandBuffer cbuf, uint32_t frame_idx, uint32_t src_fam, uint32_t dst_fam) const;
+		void acquire(VkCommandBuffer cbuf, uint32_t frame_idx, uint32_t src_fam, uint32_t dst_fam) const;
+
+		// Records the draws inside a render pass, with a graphics
+		// pipeline and the objects' vertex and index buffers bound.
+		// Works in secondary command buffers too.
+		void draw(VkCommandBuffer cbuf, uint32_t frame_idx) const;
+
+		auto object_ct() const -> uint32_t;
+
+	private:
+		// Same layout as Params in cull.comp (std140)
+		struct Params {
+			Frustum planes;
+			uint32_t object_ct;
+			uint32_t compact;
+		};
+
+		struct Slot {
+			VkBuffer params;
+			ll::memory::Allocation params_memory;
+			upload::Buffer draws;
+			upload::Buffer count;
+			VkDescriptorSet set;
+		};
+
+		ll::memory::Allocator& allocator;
+		VkDevice device;
+		uint32_t obj_ct;
+		bool indirect_count;
+
+		upload::Buffer object_buf;
+		std::vector<Slot> slots;
+
+		VkDescriptorSetLayout set_layout;
+		VkDescriptorPool desc_pool;
+		VkPipelineLayout pipeline_layout;
+		VkPipeline pipeline;
+	};
+}
+
+#endif // CULL_H
@@ -0,0 +1,642 @@
+#include "graph.hpp"
+
+#include "ll/cbuf.hpp"
+#include "ll/image.hpp"
+#include "ll/rpass.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+#include <utility>
+
+namespace graph {
+	// What a transient image needs to be created with to be used in
+	// layout
+	static auto usage_flags(const Usage& usage) -> VkImageUsageFlags {
+		switch (usage.layout) {
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+			return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return VK_IMAGE_USAGE_SAMPLED_BIT;
+		case VK_IMAGE_LAYOUT_GENERAL: return VK_IMAGE_USAGE_STORAGE_BIT;
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		default: return 0;
+		}
+	}
+
+	const VkImageUsageFlags ATTACHMENT_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+		| VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+	Graph::Graph(ll::memory::Allocator& allocator, VkDevice device,
+		     ll::rpass::RpassCache& rpasses, ll::rpass::FramebufferCache& fbs)
+		: allocator(allocator), device(device), rpasses(&rpasses), fbs(&fbs) {}
+
+	Graph::Graph(ll::memory::Allocator& allocator, VkDevice device)
+		: allocator(allocator), device(device), rpasses(nullptr), fbs(nullptr) {}
+
+	Graph::~Graph() {
+		for (auto& res : resources) {
+			if (res.imported || !res.is_image || res.image == VK_NULL_HANDLE) continue;
+			if (fbs != nullptr) fbs->evict(res.view);
+			vkDestroyImageView(device, res.view, nullptr);
+			vkDestroyImage(device, res.image, nullptr);
+		}
+
+		for (auto& slot : slots) allocator.free(slot.memory);
+	}
+
+	auto Graph::image(const ImageDesc& desc) -> Resource {
+		ResourceInfo info{};
+		info.is_image = true;
+		info.imported = false;
+		info.desc = desc;
+		resources.push_back(info);
+
+		return resources.size() - 1;
+	}
+
+	auto Graph::import_image(VkImage image, VkImageView view, const ImageDesc& desc,
+				 const Usage& initial, const Usage& final) -> Resource {
+		ResourceInfo info{};
+		info.is_image = true;
+		info.imported = true;
+		info.desc = desc;
+		info.image = image;
+		info.view = view;
+		info.initial = initial;
+		info.final = final;
+		resources.push_back(info);
+
+		return resources.size() - 1;
+	}
+
+	auto Graph::import_buffer(VkBuffer buffer, const Usage& initial, const Usage& final) -> Resource {
+		ResourceInfo info{};
+		info.is_image = false;
+		info.imported = true;
+		info.buffer = buffer;
+		info.initial = initial;
+		info.final = final;
+		resources.push_back(info);
+
+		return resources.size() - 1;
+	}
+
+	void Graph::set_image(Resource resource, VkImage image, VkImageView view) {
+		auto& res = resources.at(resource);
+		if (!res.imported || !res.is_image) throw std::runtime_error("Can only swap imported images!");
+		res.image = image;
+		res.view = view;
+	}
+
+	void Graph::set_buffer(Resource resource, VkBuffer buffer) {
+		auto& res = resources.at(resource);
+		if (!res.imported || res.is_image) throw std::runtime_error("Can only swap imported buffers!");
+		res.buffer = buffer;
+	}
+
+	auto Graph::add_pass(Pass pass) -> uint32_t {
+		if (compiled) throw std::runtime_error("Can't add passes to a compiled graph!");
+
+		for (auto& attachment : attachments(pass))
+			if (attachment.resource >= resources.size() || !resources[attachment.resource].is_image)
+				throw std::runtime_error("Pass " + pass.name + " has an attachment that isn't an image!");
+
+		if (!pass.resolves.empty() && pass.resolves.size() != pass.colors.size())
+			throw std::runtime_error("Pass " + pass.name + " needs one resolve per color attachment!");
+		for (auto& use : pass.uses)
+			if (use.resource >= resources.size())
+				throw std::runtime_error("Pass " + pass.name + " uses a resource that doesn't exist!");
+
+		passes.push_back(std::move(pass));
+
+		return passes.size() - 1;
+	}
+
+	auto Graph::attachments(const Pass& pass) -> std::vector<Attachment> {
+		auto all = pass.colors;
+		for (auto r : pass.resolves) all.push_back({r, std::nullopt});
+		if (pass.depth.has_value()) all.push_back(pass.depth.value());
+		return all;
+	}
+
+	auto Graph::uses(const Pass& pass) const -> std::vector<Use> {
+		std::vector<Use> all;
+		for (auto& color : pass.colors) {
+			auto usage = COLOR_ATTACHMENT;
+			// Clearing doesn't look at what was there before
+			if (color.clear.has_value()) usage.access &= WRITE_ACCESS;
+			all.push_back({color.resource, usage});
+		}
+		// Every pixel of a resolve target is overwritten
+		for (auto r : pass.resolves)
+			all.push_back({r, {COLOR_ATTACHMENT.stage, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+					   COLOR_ATTACHMENT.layout}});
+		if (pass.depth.has_value()) {
+			auto usage = DEPTH_ATTACHMENT;
+			if (pass.depth->clear.has_value()) usage.access &= WRITE_ACCESS;
+			all.push_back({pass.depth->resource, usage});
+		}
+		all.insert(all.end(), pass.uses.begin(), pass.uses.end());
+
+		// Merge uses of the same resource, which have to agree on the
+		// layout
+		std::vector<Use> merged;
+		for (auto& use : all) {
+			auto it = std::find_if(merged.begin(), merged.end(),
+					       [&](auto& m) { return m.resource == use.resource; });
+			if (it == merged.end()) {
+				merged.push_back(use);
+				continue;
+			}
+
+			if (resources[use.resource].is_image && it->usage.layout != use.usage.layout)
+				throw std::runtime_error("Pass " + pass.name + " uses an image in two layouts!");
+			it->usage.stage |= use.usage.stage;
+			it->usage.access |= use.usage.access;
+		}
+
+		return merged;
+	}
+
+	auto Graph::writes(const Pass& pass, Resource resource) const -> bool {
+		for (auto& use : uses(pass))
+			if (use.resource == resource && (use.usage.access & WRITE_ACCESS)) return true;
+		return false;
+	}
+
+	auto Graph::reads(const Pass& pass, Resource resource) const -> bool {
+		for (auto& use : uses(pass))
+			if (use.resource == resource && (use.usage.access & ~WRITE_ACCESS)) return true;
+		return false;
+	}
+
+	void Graph::compile() {
+		if (compiled) throw std::runtime_error("Graph has already been compiled!");
+
+		cull();
+		create_transients();
+		create_rpasses();
+		compute_barriers();
+
+		compiled = true;
+	}
+
+	void Graph::cull() {
+		std::vector<bool> needed(passes.size(), false);
+
+		// The last write to an imported resource is what the caller
+		// sees after the graph runs
+		for (Resource r = 0; r < resources.size(); ++r) {
+			if (!resources[r].imported) continue;
+			for (size_t i = passes.size(); i-- > 0;) {
+				if (writes(passes[i], r)) {
+					needed[i] = true;
+					break;
+				}
+			}
+		}
+		for (size_t i = 0; i < passes.size(); ++i)
+			if (passes[i].side_effects) needed[i] = true;
+
+		// Whatever a needed pass reads, the last pass to write it
+		// before is needed too. Walking backwards visits every pass
+		// after everything that could make it needed.
+		for (size_t i = passes.size(); i-- > 0;) {
+			if (!needed[i]) continue;
+			for (auto& use : uses(passes[i])) {
+				if (!(use.usage.access & ~WRITE_ACCESS)) continue;
+				for (size_t j = i; j-- > 0;) {
+					if (writes(passes[j], use.resource)) {
+						needed[j] = true;
+						break;
+					}
+				}
+			}
+		}
+
+		culled_passes.resize(passes.size());
+		for (size_t i = 0; i < passes.size(); ++i) culled_passes[i] = !needed[i];
+	}
+
+	void Graph::create_transients() {
+		const uint32_t UNUSED = UINT32_MAX;
+
+		// First and last pass using every transient image
+		std::vector<uint32_t> first(resources.size(), UNUSED), last(resources.size(), UNUSED);
+		for (uint32_t i = 0; i < passes.size(); ++i) {
+			if (culled_passes[i]) continue;
+			for (auto& use : uses(passes[i])) {
+				auto& res = resources[use.resource];
+				if (res.imported) continue;
+				if (first[use.resource] == UNUSED) first[use.resource] = i;
+				last[use.resource] = i;
+				res.image_usage |= usage_flags(use.usage);
+			}
+		}
+
+		std::vector<Resource> transients;
+		for (Resource r = 0; r < resources.size(); ++r)
+			if (!resources[r].imported && first[r] != UNUSED) transients.push_back(r);
+		std::stable_sort(transients.begin(), transients.end(),
+				 [&](Resource a, Resource b) { return first[a] < first[b]; });
+
+		// Hand every image the memory of one that is dead by the time
+		// it's first used, if there is one it can live in
+		for (auto r : transients) {
+			auto& res = resources[r];
+			auto settings = ll::image::IMAGE_DEFAULTS;
+			settings.samples = res.desc.samples;
+			// Nothing outside the pass ever sees it
+			auto usage = res.image_usage;
+			if (first[r] == last[r] && (usage & ~ATTACHMENT_USAGE) == 0)
+				usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+			res.image = ll::image::create(device, res.desc.format, res.desc.width, res.desc.height,
+						      usage, settings);
+
+			VkMemoryRequirements reqs;
+			vkGetImageMemoryRequirements(device, res.image, &reqs);
+			unaliased += reqs.size;
+
+			std::optional<uint32_t> found;
+			for (uint32_t s = 0; s < slots.size(); ++s) {
+				auto& slot = slots[s];
+				if (slot.last_pass >= first[r]) continue;
+				if (!(slot.reqs.memoryTypeBits & reqs.memoryTypeBits)) continue;
+				// Prefer slots that don't have to grow
+				if (!found.has_value() || (slot.reqs.size >= reqs.size
+							   && slots[found.value()].reqs.size < reqs.size))
+					found = s;
+			}
+
+			if (!found.has_value()) {
+				slots.push_back({reqs, {}, {}, 0});
+				found = slots.size() - 1;
+			}
+
+			auto& slot = slots[found.value()];
+			slot.reqs.size = std::max(slot.reqs.size, reqs.size);
+			slot.reqs.alignment = std::max(slot.reqs.alignment, reqs.alignment);
+			slot.reqs.memoryTypeBits &= reqs.memoryTypeBits;
+			slot.images.push_back(r);
+			slot.last_pass = last[r];
+			res.slot = found.value();
+		}
+
+		for (auto& slot : slots) {
+			// Only memory types that every image in the slot allows
+			// are left, so this is only lazily allocated if they are
+			// all transient attachments
+			slot.memory = allocator.allocate(slot.reqs, false, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+							 VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+			for (auto r : slot.images) {
+				auto& res = resources[r];
+				if (vkBindImageMemory(device, res.image, slot.memory.memory, slot.memory.offset) != VK_SUCCESS)
+					throw std::runtime_error("Could not bind transient image memory!");
+				res.view = ll::image::to_view(device, res.image, res.desc.format,
+							      {ll::image::range(res.desc.format)});
+			}
+		}
+	}
+
+	void Graph::create_rpasses() {
+		for (uint32_t i = 0; i < passes.size(); ++i) {
+			if (culled_passes[i]) continue;
+			auto& pass = passes[i];
+
+			CompiledPass compiled{};
+			compiled.pass = i;
+
+			// Colors, then resolves, then depth, same as the
+			// framebuffer's views
+			ll::rpass::RpassDesc desc;
+			for (auto& attachment : attachments(pass)) {
+				auto& res = resources[attachment.resource];
+				if (desc.attachments.empty()) {
+					compiled.width = res.desc.width;
+					compiled.height = res.desc.height;
+				} else if (res.desc.width != compiled.width || res.desc.height != compiled.height) {
+					throw std::runtime_error("Attachments of pass " + pass.name
+								 + " don't have the same size!");
+				}
+
+				auto is_depth = pass.depth.has_value() && attachment.resource == pass.depth->resource;
+				auto is_resolve = !is_depth && desc.colors.size() == pass.colors.size();
+				if (is_resolve && res.desc.samples != VK_SAMPLE_COUNT_1_BIT)
+					throw std::runtime_error("Pass " + pass.name + " resolves into a multisampled image!");
+
+				// Load what's there only if something put it
+				// there and it isn't overwritten anyway, store it
+				// only if someone will look at it
+				auto has_contents = res.imported && res.initial.layout != VK_IMAGE_LAYOUT_UNDEFINED;
+				auto is_read_later = res.imported;
+				for (uint32_t j = 0; j < passes.size(); ++j) {
+					if (culled_passes[j]) continue;
+					if (j < i && writes(passes[j], attachment.resource)) has_contents = true;
+					if (j > i && reads(passes[j], attachment.resource)) is_read_later = true;
+				}
+
+				auto layout = is_depth ? DEPTH_ATTACHMENT.layout : COLOR_ATTACHMENT.layout;
+				auto settings = is_depth ? ll::rpass::DEPTH_ATTACHMENT_DEFAULTS : ll::rpass::ATTACHMENT_DEFAULTS;
+				settings.samples = res.desc.samples;
+				settings.load = attachment.clear.has_value() ? VK_ATTACHMENT_LOAD_OP_CLEAR
+					: has_contents && !is_resolve ? VK_ATTACHMENT_LOAD_OP_LOAD
+					: VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				settings.store = is_read_later ? VK_ATTACHMENT_STORE_OP_STORE
+					: VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				// Stencil is treated like depth, if there is any
+				if (ll::image::aspect(res.desc.format) & VK_IMAGE_ASPECT_STENCIL_BIT) {
+					settings.stencil_load = settings.load;
+					settings.stencil_store = settings.store;
+				}
+				// Layout transitions happen in barriers outside the
+				// render pass
+				settings.initial_layout = layout;
+				settings.final_layout = layout;
+				desc.attachments.push_back(ll::rpass::attachment(res.desc.format, settings));
+
+				auto ref = ll::rpass::attachment_ref(desc.attachments.size() - 1, layout);
+				if (is_depth) desc.depth = ref;
+				else if (is_resolve) desc.resolves.push_back(ref);
+				else desc.colors.push_back(ref);
+
+				compiled.clear_values.push_back(attachment.clear.value_or(VkClearValue{}));
+			}
+
+			if (!desc.attachments.empty() && rpasses != nullptr) compiled.rpass = rpasses->get(desc);
+			compiled.desc = std::move(desc);
+
+			compiled_passes.push_back(std::move(compiled));
+		}
+	}
+
+	void Graph::compute_barriers() {
+		// What later uses of a resource have to wait for
+		struct State {
+			VkImageLayout layout;
+			// The last write and everything reading since. A layout
+			// transition counts as a write by the stage it was
+			// waited for in.
+			VkPipelineStageFlags write_stage;
+			VkAccessFlags write_access;
+			VkPipelineStageFlags read_stages;
+			// Where the last write has been made visible already
+			VkPipelineStageFlags visible_stages;
+			VkAccessFlags visible_access;
+		};
+
+		auto state_after = [](const Usage& usage) {
+			State state{};
+			state.layout = usage.layout;
+			if (usage.access & WRITE_ACCESS) {
+				state.write_stage = usage.stage;
+				state.write_access = usage.access & WRITE_ACCESS;
+			} else {
+				state.read_stages = usage.stage;
+			}
+			return state;
+		};
+
+		// The last use of every transient image, so the next image in
+		// the same memory can wait for it
+		std::vector<Usage> last_use(resources.size(), Usage{0, 0, VK_IMAGE_LAYOUT_UNDEFINED});
+		for (auto& compiled : compiled_passes)
+			for (auto& use : uses(passes[compiled.pass]))
+				last_use[use.resource] = use.usage;
+
+		std::vector<State> states(resources.size());
+		for (Resource r = 0; r < resources.size(); ++r) {
+			auto& res = resources[r];
+			if (res.imported) {
+				states[r] = state_after(res.initial);
+			} else if (res.image != VK_NULL_HANDLE) {
+				// The previous image in the slot, or the last one
+				// from the previous frame. Its contents are gone.
+				auto& images = slots[res.slot].images;
+				auto it = std::find(images.begin(), images.end(), r);
+				auto prev = it == images.begin() ? images.back() : *(it - 1);
+				states[r] = state_after(last_use[prev]);
+				states[r].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+		}
+
+		auto add_barrier = [&](BarrierBatch& batch, Resource r, const Usage& usage) {
+			auto& res = resources[r];
+			auto& state = states[r];
+			auto transition = res.is_image && usage.layout != state.layout;
+			auto is_write = (usage.access & WRITE_ACCESS) != 0;
+
+			if (transition || is_write) {
+				// Wait for everything since the last write too, so
+				// they don't see what we're about to do
+				auto src_stage = state.write_stage | state.read_stages;
+				if (transition || src_stage != 0) {
+					batch.src_stage |= src_stage;
+					batch.dst_stage |= usage.stage;
+					batch.barriers.push_back({r, state.layout, usage.layout,
+								  state.write_access, usage.access});
+				}
+
+				if (is_write) {
+					state = state_after(usage);
+				} else {
+					state.layout = usage.layout;
+					state.write_stage = usage.stage;
+					state.write_access = 0;
+					state.read_stages = usage.stage;
+					state.visible_stages = usage.stage;
+					state.visible_access = usage.access;
+				}
+				return;
+			}
+
+			// Reads only have to wait if the last write hasn't been
+			// made visible to them yet
+			auto visible = (usage.stage & ~state.visible_stages) == 0
+				&& (usage.access & ~state.visible_access) == 0;
+			if (state.write_stage != 0 && !visible) {
+				batch.src_stage |= state.write_stage;
+				batch.dst_stage |= usage.stage;
+				batch.barriers.push_back({r, state.layout, usage.layout, state.write_access, usage.access});
+				state.visible_stages |= usage.stage;
+				state.visible_access |= usage.access;
+			}
+			state.read_stages |= usage.stage;
+		};
+
+		for (auto& compiled : compiled_passes)
+			for (auto& use : uses(passes[compiled.pass]))
+				add_barrier(compiled.before, use.resource, use.usage);
+
+		for (Resource r = 0; r < resources.size(); ++r)
+			if (resources[r].imported) add_barrier(after, r, resources[r].final);
+	}
+
+	void Graph::record_barriers(VkCommandBuffer cbuf, const BarrierBatch& batch) const {
+		if (batch.barriers.empty()) return;
+
+		std::vector<VkImageMemoryBarrier> image_barriers;
+		std::vector<VkBufferMemoryBarrier> buffer_barriers;
+		for (auto& b : batch.barriers) {
+			auto& res = resources[b.resource];
+			if (res.is_image) {
+				VkImageMemoryBarrier barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier.srcAccessMask = b.src_access;
+				barrier.dstAccessMask = b.dst_access;
+				barrier.oldLayout = b.old_layout;
+				barrier.newLayout = b.new_layout;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.image = res.image;
+				barrier.subresourceRange = ll::image::range(res.desc.format);
+				image_barriers.push_back(barrier);
+			} else {
+				VkBufferMemoryBarrier barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+				barrier.srcAccessMask = b.src_access;
+				barrier.dstAccessMask = b.dst_access;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.buffer = res.buffer;
+				barrier.offset = 0;
+				barrier.size = VK_WHOLE_SIZE;
+				buffer_barriers.push_back(barrier);
+			}
+		}
+
+		// A barrier with no stages on one side only orders layout
+		// transitions, which the top and bottom of the pipe are for
+		auto src_stage = batch.src_stage, dst_stage = batch.dst_stage;
+		if (src_stage == 0) src_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		if (dst_stage == 0) dst_stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		vkCmdPipelineBarrier(cbuf, src_stage, dst_stage, 0, 0, nullptr,
+				     buffer_barriers.size(), buffer_barriers.data(),
+				     image_barriers.size(), image_barriers.data());
+	}
+
+	auto Graph::framebuffer(const CompiledPass& compiled) const -> VkFramebuffer {
+		// Imported views change, so this is looked up every time
+		std::vector<VkImageView> views;
+		for (auto& attachment : attachments(passes[compiled.pass]))
+			views.push_back(resources[attachment.resource].view);
+
+		return fbs->get(compiled.rpass, views, compiled.width, compiled.height);
+	}
+
+	void Graph::begin_rendering(VkCommandBuffer cbuf, const CompiledPass& compiled) const {
+		// Same order as the render pass's attachments, the views of
+		// imported images are looked up every time
+		auto& desc = compiled.desc;
+		auto pass_attachments = attachments(passes[compiled.pass]);
+		auto view = [&](const VkAttachmentReference& ref) {
+			return resources[pass_attachments[ref.attachment].resource].view;
+		};
+
+		std::vector<VkRenderingAttachmentInfo> colors;
+		for (size_t i = 0; i < desc.colors.size(); ++i) {
+			auto& ref = desc.colors[i];
+			auto& attachment = desc.attachments[ref.attachment];
+			auto resolve_view = desc.resolves.empty() ? VK_NULL_HANDLE : view(desc.resolves[i]);
+			colors.push_back(ll::cbuf::rendering_attachment(view(ref), ref.layout,
+									attachment.loadOp, attachment.storeOp,
+									compiled.clear_values[ref.attachment],
+									resolve_view));
+		}
+
+		// Stencil is cleared and stored along with depth, if the format
+		// has any
+		VkRenderingAttachmentInfo depth{}, stencil{};
+		auto has_stencil = false;
+		if (desc.depth.has_value()) {
+			auto& ref = *desc.depth;
+			auto& attachment = desc.attachments[ref.attachment];
+			auto clear = compiled.clear_values[ref.attachment];
+			depth = ll::cbuf::rendering_attachment(view(ref), ref.layout,
+							       attachment.loadOp, attachment.storeOp, clear);
+			has_stencil = ll::image::aspect(attachment.format) & VK_IMAGE_ASPECT_STENCIL_BIT;
+			stencil = ll::cbuf::rendering_attachment(view(ref), ref.layout, attachment.stencilLoadOp,
+								 attachment.stencilStoreOp, clear);
+		}
+
+		ll::cbuf::begin_rendering(cbuf, compiled.width, compiled.height, colors,
+					  desc.depth.has_value() ? &depth : nullptr, has_stencil ? &stencil : nullptr);
+	}
+
+	auto Graph::rpass(uint32_t pass) const -> VkRenderPass {
+		for (auto& compiled : compiled_passes)
+			if (compiled.pass == pass) return compiled.rpass;
+		return VK_NULL_HANDLE;
+	}
+
+	auto Graph::formats(uint32_t pass) const -> ll::pipeline::RenderingFormats {
+		auto& p = passes.at(pass);
+
+		ll::pipeline::RenderingFormats formats;
+		for (auto& attachment : p.colors) formats.colors.push_back(resources[attachment.resource].desc.format);
+		if (p.depth.has_value()) {
+			auto format = resources[p.depth->resource].desc.format;
+			formats.depth = format;
+			if (ll::image::aspect(format) & VK_IMAGE_ASPECT_STENCIL_BIT) formats.stencil = format;
+		}
+
+		return formats;
+	}
+
+	auto Graph::culled(uint32_t pass) const -> bool {
+		return culled_passes.at(pass);
+	}
+
+	auto Graph::view(Resource resource) const -> VkImageView {
+		return resources.at(resource).view;
+	}
+
+	void Graph::execute(VkCommandBuffer cbuf) {
+		if (!compiled) throw std::runtime_error("Graph has to be compiled before executing it!");
+
+		for (auto& compiled : compiled_passes) {
+			record_barriers(cbuf, compiled.before);
+
+			auto& pass = passes[compiled.pass];
+			if (compiled.rpass != VK_NULL_HANDLE) {
+				ll::cbuf::begin_rpass(cbuf, compiled.rpass, framebuffer(compiled),
+						      compiled.width, compiled.height, compiled.clear_values);
+				if (pass.record) pass.record(cbuf);
+				ll::cbuf::end_rpass(cbuf);
+			} else if (!compiled.desc.attachments.empty()) {
+				begin_rendering(cbuf, compiled);
+				if (pass.record) pass.record(cbuf);
+				ll::cbuf::end_rendering(cbuf);
+			} else if (pass.record) {
+				pass.record(cbuf);
+			}
+		}
+
+		record_barriers(cbuf, after);
+	}
+
+	auto Graph::transient_size() const -> VkDeviceSize {
+		VkDeviceSize size = 0;
+		for (auto& slot : slots) size += slot.reqs.size;
+		return size;
+	}
+
+	auto Graph::unaliased_size() const -> VkDeviceSize {
+		return unaliased;
+	}
+
+	void Graph::print_stats(std::ostream& out) const {
+		const double MIB = 1024.0 * 1024.0;
+
+		auto kept = std::count(culled_passes.begin(), culled_passes.end(), false);
+		size_t image_ct = 0;
+		for (auto& slot : slots) image_ct += slot.images.size();
+
+		out << "Render graph: " << kept << " of " << passes.size() << " passes kept, "
+		    << image_ct << " transient images in " << slots.size() << " allocations, "
+		    << std::fixed << std::setprecision(2) << transient_size() / MIB << " MiB ("
+		    << unaliased_size() / MIB << " MiB without aliasing)" << std::endl;
+	}
+}
@@ -0,0 +1,306 @@
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include "ll/memory.hpp"
+#include "ll/pipeline.hpp"
+#include "ll/rpass.hpp"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace graph {
+	// How a pass touches a resource. Layout is ignored for buffers.
+	struct Usage {
+		VkPipelineStageFlags stage;
+		VkAccessFlags access;
+		VkImageLayout layout;
+	};
+
+	const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT
+		| VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	const Usage COLOR_ATTACHMENT {
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+	};
+	const Usage DEPTH_ATTACHMENT {
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+	};
+	const Usage SAMPLED_FRAGMENT {
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	};
+	const Usage SAMPLED_COMPUTE {
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	};
+	const Usage STORAGE_READ_COMPUTE {
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_GENERAL
+	};
+	// Overwrites everything, so earlier contents are never waited for
+	const Usage STORAGE_WRITE_COMPUTE {
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_SHADER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_GENERAL
+	};
+	const Usage STORAGE_READ_WRITE_COMPUTE {
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_GENERAL
+	};
+	const Usage INDIRECT_READ {
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED
+	};
+	const Usage VERTEX_READ {
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED
+	};
+	const Usage TRANSFER_SRC {
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_TRANSFER_READ_BIT,
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+	};
+	const Usage TRANSFER_DST {
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+	};
+	// Final usage of swapchain images
+	const Usage PRESENT {
+		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		0,
+		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+	};
+	// Initial usage of freshly acquired swapchain images. The stage has
+	// to match the one the acquire semaphore is waited on in.
+	const Usage ACQUIRED {
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		0,
+		VK_IMAGE_LAYOUT_UNDEFINED
+	};
+
+	using Resource = uint32_t;
+
+	struct ImageDesc {
+		VkFormat format;
+		uint32_t width;
+		uint32_t height;
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	};
+
+	struct Attachment {
+		Resource resource;
+		// Without a clear value, the previous contents are loaded if
+		// anything wrote them. Color or depth, depending on the
+		// attachment.
+		std::optional<VkClearValue> clear;
+	};
+
+	struct Use {
+		Resource resource;
+		Usage usage;
+	};
+
+	// Recorded outside of any render pass for passes without attachments,
+	// inside the pass's render pass (or dynamic rendering) otherwise
+	using RecordFn = std::function<void(VkCommandBuffer)>;
+
+	struct Pass {
+		std::string name;
+		// Graphics passes get a render pass with one subpass that
+		// writes these. They all have to be the same size.
+		std::vector<Attachment> colors;
+		// Either empty or one single-sampled image per (multisampled)
+		// color attachment, which it gets resolved into at the end of
+		// the subpass
+		std::vector<Resource> resolves;
+		std::optional<Attachment> depth;
+		// Everything else the pass reads or writes
+		std::vector<Use> uses;
+		// Kept even if nothing uses its outputs, e.g. because it
+		// writes to memory the graph doesn't know about
+		bool side_effects = false;
+		RecordFn record;
+	};
+
+	// Orders a frame's passes by the resources they declare, instead of
+	// by hand-written barriers and render pass dependencies.
+	//
+	// Add resources and passes in execution order, then compile() once.
+	// Compiling:
+	//   - culls passes none of whose outputs reach an imported resource
+	//     (or a pass with side effects)
+	//   - creates the transient images and lets images whose lifetimes
+	//     don't overlap share memory. Images that are only attachments
+	//     of a single pass (like multisampled color and depth) are
+	//     created as transient attachments in lazily allocated memory,
+	//     if the device has any.
+	//   - picks attachment load and store ops, so transients that don't
+	//     outlive their pass are never written to memory
+	//   - works out the fewest barriers and layout transitions between
+	//     passes, batched into one vkCmdPipelineBarrier per pass
+	// After that, execute() records the whole frame. Rebuild the graph
+	// when formats or sizes change: render passes and framebuffers come
+	// from caches that outlive it, so a rebuilt graph that only changed
+	// sizes gets the same render passes back. With dynamic rendering
+	// there are neither, and pipelines are built against formats().
+	//
+	// Transient images start every frame undefined. Their first use waits
+	// for the last use of the same memory in the previous frame, so
+	// frames in flight can share them as long as they are submitted to
+	// one queue.
+	struct Graph {
+		// Framebuffers using the graph's own images are evicted when
+		// it's destroyed, imported views have to be evicted by
+		// whoever destroys them
+		Graph(ll::memory::Allocator& allocator, VkDevice device,
+		      ll::rpass::RpassCache& rpasses, ll::rpass::FramebufferCache& fbs);
+		// Records graphics passes with dynamic rendering instead of
+		// render passes. Needs the dynamicRendering feature.
+		Graph(ll::memory::Allocator& allocator, VkDevice device);
+		~Graph();
+
+		Graph(const Graph&) = delete;
+		auto operator=(const Graph&) -> Graph& = delete;
+
+		// Created and owned by the graph
+		auto image(const ImageDesc& desc) -> Resource;
+
+		// Owned by the caller. Initial is how the resource was last
+		// used before execute(), final is what it is left ready for.
+		auto import_image(VkImage image, VkImageView view, const ImageDesc& desc,
+				  const Usage& initial, const Usage& final) -> Resource;
+		auto import_buffer(VkBuffer buffer, const Usage& initial, const Usage& final) -> Resource;
+
+		// Swaps an imported resource for another one with the same
+		// description, e.g. the swapchain image acquired this frame
+		void set_image(Resource resource, VkImage image, VkImageView view);
+		void set_buffer(Resource resource, VkBuffer buffer);
+
+		// Returns the pass's index
+		auto add_pass(Pass pass) -> uint32_t;
+
+		void compile();
+
+		// Only valid after compile(). VK_NULL_HANDLE for passes without
+		// attachments, culled ones and with dynamic rendering.
+		// Pipelines can be built against it, with color_ct set to
+		// the pass's number of colors.
+		auto rpass(uint32_t pass) const -> VkRenderPass;
+		// What to build a pass's pipelines against with dynamic
+		// rendering. Valid as soon as the pass is added.
+		auto formats(uint32_t pass) const -> ll::pipeline::RenderingFormats;
+		auto culled(uint32_t pass) const -> bool;
+		auto view(Resource resource) const -> VkImageView;
+
+		void execute(VkCommandBuffer cbuf);
+
+		// Memory taken by transient images, with and without aliasing
+		auto transient_size() const -> VkDeviceSize;
+		auto unaliased_size() const -> VkDeviceSize;
+		void print_stats(std::ostream& out) const;
+
+	private:
+		struct ResourceInfo {
+			bool is_image;
+			bool imported;
+			ImageDesc desc;
+			VkImage image;
+			VkImageView view;
+			VkBuffer buffer;
+			Usage initial;
+			Usage final;
+			// Accumulated from every use, for transient images
+			VkImageUsageFlags image_usage;
+			// Index into slots, transient images only
+			uint32_t slot;
+		};
+
+		struct Barrier {
+			Resource resource;
+			VkImageLayout old_layout;
+			VkImageLayout new_layout;
+			VkAccessFlags src_access;
+			VkAccessFlags dst_access;
+		};
+
+		// Recorded before a pass (or after the last one, for imported
+		// resources)
+		struct BarrierBatch {
+			VkPipelineStageFlags src_stage = 0;
+			VkPipelineStageFlags dst_stage = 0;
+			std::vector<Barrier> barriers;
+		};
+
+		struct CompiledPass {
+			uint32_t pass;
+			BarrierBatch before;
+			VkRenderPass rpass;
+			// What rpass was made from, and what dynamic
+			// rendering begins with instead
+			ll::rpass::RpassDesc desc;
+			std::vector<VkClearValue> clear_values;
+			uint32_t width;
+			uint32_t height;
+		};
+
+		// A piece of memory shared by transient images that are never
+		// alive at the same time
+		struct Slot {
+			VkMemoryRequirements reqs;
+			ll::memory::Allocation memory;
+			// Images in the order they use the memory
+			std::vector<Resource> images;
+			uint32_t last_pass;
+		};
+
+		ll::memory::Allocator& allocator;
+		VkDevice device;
+		// Both null with dynamic rendering
+		ll::rpass::RpassCache* rpasses;
+		ll::rpass::FramebufferCache* fbs;
+		bool compiled = false;
+
+		std::vector<ResourceInfo> resources;
+		std::vector<Pass> passes;
+		std::vector<bool> culled_passes;
+
+		std::vector<CompiledPass> compiled_passes;
+		BarrierBatch after;
+		std::vector<Slot> slots;
+		VkDeviceSize unaliased = 0;
+
+		// In framebuffer order: colors, resolves, depth
+		static auto attachments(const Pass& pass) -> std::vector<Attachment>;
+		auto writes(const Pass& pass, Resource resource) const -> bool;
+		auto reads(const Pass& pass, Resource resource) const -> bool;
+		// Every use of a pass including its attachments, one per resource
+		auto uses(const Pass& pass) const -> std::vector<Use>;
+
+		void cull();
+		void create_transients();
+		void create_rpasses();
+		void compute_barriers();
+		void record_barriers(VkCommandBuffer cbuf, const BarrierBatch& batch) const;
+		auto framebuffer(const CompiledPass& compiled) const -> VkFramebuffer;
+		void begin_rendering(VkCommandBuffer cbuf, const CompiledPass& compiled) const;
+	};
+}
+
+#endif // GRAPH_H
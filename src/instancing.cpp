@@ -0,0 +1,158 @@
+#include "instancing.hpp"
+
+#include "ll/buffer.hpp"
+#include "ll/cbuf.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace instancing {
+	void add_streams(ll::pipeline::PipelineSettings& settings, const std::vector<Stream>& streams,
+			 uint32_t first_binding, uint32_t first_location)
+	{
+		for (uint32_t i = 0; i < streams.size(); ++i) {
+			settings.vertex_bindings.push_back(
+				ll::pipeline::vertex_binding(first_binding + i, streams[i].size,
+							     VK_VERTEX_INPUT_RATE_INSTANCE));
+			settings.vertex_attributes.push_back(
+				ll::pipeline::vertex_attribute(first_location + i, first_binding + i,
+							       streams[i].format, 0));
+		}
+	}
+
+	auto key(VkPipeline pipeline, const upload::Mesh& mesh) -> DrawKey {
+		return {pipeline, mesh.vertices.handle, mesh.indices.handle, mesh.index_ct};
+	}
+
+	Batcher::Batcher(ll::memory::Allocator& allocator, VkDevice device, std::vector<Stream> streams,
+			 uint32_t first_binding, uint32_t frame_ct, uint32_t max_instances)
+		: allocator(allocator), device(device), streams(std::move(streams)), first_binding(first_binding),
+		  frame_ct(frame_ct), max_instances(max_instances)
+	{
+		if (frame_ct == 0) throw std::runtime_error("Need at least one frame in flight!");
+
+		for (const auto& stream : this->streams) {
+			VkDeviceSize size = static_cast<VkDeviceSize>(stream.size) * max_instances * frame_ct;
+			StreamBuffer sb{};
+			sb.buffer = ll::buffer::create(device, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+			// Written every frame, read once by the GPU
+			sb.memory = allocator.bind(sb.buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+						   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			buffers.push_back(sb);
+		}
+	}
+
+	Batcher::~Batcher() {
+		for (const auto& sb : buffers) {
+			vkDestroyBuffer(device, sb.buffer, nullptr);
+			allocator.free(sb.memory);
+		}
+	}
+
+	void Batcher::begin_frame(uint32_t idx) {
+		if (idx >= frame_ct) throw std::runtime_error("Frame index out of range!");
+		frame_idx = idx;
+
+		// Keep the batches (and their capacity) around, the same keys
+		// usually come back next frame. Ones that weren't used last
+		// frame are dropped.
+		for (auto it = batches.begin(); it != batches.end();) {
+			auto& batch = it->second;
+			if (batch.instance_ct == 0) {
+				it = batches.erase(it);
+				continue;
+			}
+			for (auto& data : batch.data) data.clear();
+			batch.instance_ct = 0;
+			++it;
+		}
+		total_instance_ct = 0;
+	}
+
+	void Batcher::add(const DrawKey& key, std::initializer_list<const void*> attrs) {
+		if (attrs.size() != streams.size()) throw std::runtime_error("Need one attribute per stream!");
+		if (total_instance_ct == max_instances) throw std::runtime_error("Too many instances!");
+
+		auto& batch = batches[key];
+		if (batch.data.empty()) batch.data.resize(streams.size());
+
+		size_t i = 0;
+		for (auto attr : attrs) {
+			auto bytes = static_cast<const uint8_t*>(attr);
+			batch.data[i].insert(batch.data[i].end(), bytes, bytes + streams[i].size);
+			i++;
+		}
+		batch.instance_ct++;
+		total_instance_ct++;
+	}
+
+	void Batcher::prepare() {
+		if (total_instance_ct == 0) return;
+
+		// Instances are numbered from the start of the frame's region,
+		// which record() binds at offset 0
+		uint32_t first = 0;
+		for (auto& [key, batch] : batches) {
+			batch.first_instance = first;
+			for (size_t i = 0; i < streams.size(); ++i) {
+				auto region = static_cast<VkDeviceSize>(streams[i].size) * max_instances * frame_idx;
+				auto dst = static_cast<uint8_t*>(buffers[i].memory.mapped) + region
+					+ static_cast<VkDeviceSize>(streams[i].size) * first;
+				std::memcpy(dst, batch.data[i].data(), batch.data[i].size());
+			}
+			first += batch.instance_ct;
+		}
+
+		for (size_t i = 0; i < streams.size(); ++i) {
+			VkDeviceSize region_size = static_cast<VkDeviceSize>(streams[i].size) * max_instances;
+			allocator.flush(buffers[i].memory, region_size * frame_idx,
+					static_cast<VkDeviceSize>(streams[i].size) * total_instance_ct);
+		}
+	}
+
+	void Batcher::record(VkCommandBuffer cbuf) const {
+		if (total_instance_ct == 0) return;
+
+		// Stream bindings survive pipeline changes, so bind them once
+		std::vector<VkBuffer> stream_handles;
+		std::vector<VkDeviceSize> stream_offsets;
+		for (size_t i = 0; i < streams.size(); ++i) {
+			stream_handles.push_back(buffers[i].buffer);
+			stream_offsets.push_back(static_cast<VkDeviceSize>(streams[i].size) * max_instances * frame_idx);
+		}
+		ll::cbuf::bind_vertex_buffers(cbuf, stream_handles, stream_offsets, first_binding);
+
+		VkPipeline bound_pipeline = VK_NULL_HANDLE;
+		VkBuffer bound_vertices = VK_NULL_HANDLE, bound_indices = VK_NULL_HANDLE;
+		for (const auto& [key, batch] : batches) {
+			if (batch.instance_ct == 0) continue;
+
+			if (key.pipeline != bound_pipeline) {
+				ll::cbuf::bind_pipeline(cbuf, key.pipeline);
+				bound_pipeline = key.pipeline;
+			}
+			if (key.vertices != bound_vertices) {
+				ll::cbuf::bind_vertex_buffers(cbuf, {key.vertices}, {0});
+				bound_vertices = key.vertices;
+			}
+			if (key.indices != bound_indices) {
+				ll::cbuf::bind_index_buffer(cbuf, key.indices);
+				bound_indices = key.indices;
+			}
+
+			ll::cbuf::draw_indexed(cbuf, key.index_ct, batch.instance_ct, 0, 0, batch.first_instance);
+		}
+	}
+
+	auto Batcher::batch_ct() const -> size_t {
+		size_t ct = 0;
+		for (const auto& [key, batch] : batches)
+			if (batch.instance_ct > 0) ct++;
+		return ct;
+	}
+
+	auto Batcher::instance_ct() const -> uint32_t {
+		return total_instance_ct;
+	}
+}
@@ -0,0 +1,115 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include "ll/memory.hpp"
+#include "ll/pipeline.hpp"
+#include "upload.hpp"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace instancing {
+	// One per-instance attribute. Every stream gets its own tightly
+	// packed buffer (structure of arrays), so a shader that only needs
+	// some attributes doesn't fetch the rest.
+	struct Stream {
+		VkFormat format;
+		uint32_t size;
+	};
+
+	// Adds one VK_VERTEX_INPUT_RATE_INSTANCE binding and attribute per
+	// stream, starting at first_binding and first_location, after the
+	// mesh's own per-vertex inputs
+	void add_streams(ll::pipeline::PipelineSettings& settings, const std::vector<Stream>& streams,
+			 uint32_t first_binding, uint32_t first_location);
+
+	// Draws that can be merged into one instanced draw
+	struct DrawKey {
+		VkPipeline pipeline;
+		// Bound to binding 0, the streams come after
+		VkBuffer vertices;
+		VkBuffer indices;
+		uint32_t index_ct;
+
+		auto operator<(const DrawKey& other) const -> bool {
+			return std::tie(pipeline, vertices, indices, index_ct)
+				< std::tie(other.pipeline, other.vertices, other.indices, other.index_ct);
+		}
+	};
+
+	auto key(VkPipeline pipeline, const upload::Mesh& mesh) -> DrawKey;
+
+	const uint32_t DEFAULT_MAX_INSTANCES = 65536;
+
+	// Collects individual draws every frame and turns every group with
+	// the same pipeline and mesh into a single draw_indexed() with one
+	// instance per original draw. Instance data is written into
+	// persistently mapped per-stream buffers, with one region per frame
+	// in flight.
+	//
+	// Descriptors, push constants, viewport and scissor are up to the
+	// caller, so every pipeline used has to share them.
+	struct Batcher {
+		// The streams are bound starting at first_binding, which has
+		// to match add_streams()
+		Batcher(ll::memory::Allocator& allocator, VkDevice device, std::vector<Stream> streams,
+			uint32_t first_binding, uint32_t frame_ct,
+			uint32_t max_instances = DEFAULT_MAX_INSTANCES);
+		~Batcher();
+
+		Batcher(const Batcher&) = delete;
+		auto operator=(const Batcher&) -> Batcher& = delete;
+
+		// Forgets last frame's draws. Only call once the GPU is done
+		// with the frame that last used this index.
+		void begin_frame(uint32_t frame_idx);
+
+		// Attrs has one pointer per stream, each to that stream's size
+		// bytes. Throws once max_instances have been added this frame.
+		void add(const DrawKey& key, std::initializer_list<const void*> attrs);
+
+		// Copies this frame's instance data into the GPU-visible
+		// buffers. Call after the last add() and before record().
+		void prepare();
+
+		// Binds and draws every batch, ordered by pipeline. Only
+		// records, so it can be called for several command buffers at
+		// once.
+		void record(VkCommandBuffer cbuf) const;
+
+		auto batch_ct() const -> size_t;
+		auto instance_ct() const -> uint32_t;
+
+	private:
+		struct Batch {
+			// One array per stream
+			std::vector<std::vector<uint8_t>> data;
+			uint32_t instance_ct = 0;
+			uint32_t first_instance = 0;
+		};
+
+		struct StreamBuffer {
+			VkBuffer buffer;
+			ll::memory::Allocation memory;
+		};
+
+		ll::memory::Allocator& allocator;
+		VkDevice device;
+		std::vector<Stream> streams;
+		uint32_t first_binding;
+		uint32_t frame_ct;
+		uint32_t max_instances;
+
+		std::vector<StreamBuffer> buffers;
+		// Sorted, so batches sharing a pipeline are next to each other
+		std::map<DrawKey, Batch> batches;
+		uint32_t total_instance_ct = 0;
+		uint32_t frame_idx = 0;
+	};
+}
+
+#endif // INSTANCING_H
@@ -0,0 +1,86 @@
+#include "buffer.hpp"
+
+#include <stdexcept>
+
+namespace ll::buffer {
+	auto create(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage) -> VkBuffer {
+		VkBufferCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		info.size = size;
+		info.usage = usage;
+		info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkBuffer buffer{};
+		if (vkCreateBuffer(device, &info, nullptr, &buffer) != VK_SUCCESS)
+			throw std::runtime_error("Could not create buffer!");
+
+		return buffer;
+	}
+
+	void copy(VkCommandBuffer cbuf, VkBuffer src, VkBuffer dst, VkDeviceSize size,
+		  VkDeviceSize src_offset, VkDeviceSize dst_offset)
+	{
+		VkBufferCopy region{};
+		region.srcOffset = src_offset;
+		region.dstOffset = dst_offset;
+		region.size = size;
+
+		vkCmdCopyBuffer(cbuf, src, dst, 1, &region);
+	}
+
+	void barrier(VkCommandBuffer cbuf, VkBuffer buffer,
+		     VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+		     VkPipelineStageFlags dst_stage, VkAccessFlags dst_access,
+		     VkDeviceSize offset, VkDeviceSize size)
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = src_access;
+		barrier.dstAccessMask = dst_access;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = buffer;
+		barrier.offset = offset;
+		barrier.size = size;
+
+		vkCmdPipelineBarrier(cbuf, src_stage, dst_stage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	void release(VkCommandBuffer cbuf, VkBuffer buffer, uint32_t src_fam, uint32_t dst_fam,
+		     VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+		     VkDeviceSize offset, VkDeviceSize size)
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = src_access;
+		// Ignored for a release
+		barrier.dstAccessMask = 0;
+		barrier.srcQueueFamilyIndex = src_fam;
+		barrier.dstQueueFamilyIndex = dst_fam;
+		barrier.buffer = buffer;
+		barrier.offset = offset;
+		barrier.size = size;
+
+		vkCmdPipelineBarrier(cbuf, src_stage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+				     0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	void acquire(VkCommandBuffer cbuf, VkBuffer buffer, uint32_t src_fam, uint32_t dst_fam,
+		     VkPipelineStageFlags dst_stage, VkAccessFlags dst_access,
+		     VkDeviceSize offset, VkDeviceSize size)
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		// Ignored for an acquire
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = dst_access;
+		barrier.srcQueueFamilyIndex = src_fam;
+		barrier.dstQueueFamilyIndex = dst_fam;
+		barrier.buffer = buffer;
+		barrier.offset = offset;
+		barrier.size = size;
+
+		vkCmdPipelineBarrier(cbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dst_stage, 0,
+				     0, nullptr, 1, &barrier, 0, nullptr);
+	}
+}
@@ -0,0 +1,34 @@
+#ifndef LL_BUFFER_H
+#define LL_BUFFER_H
+
+#include <vulkan/vulkan.h>
+
+namespace ll::buffer {
+	// Creates an exclusive buffer, memory has to be bound separately
+	auto create(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage) -> VkBuffer;
+
+	// Records a copy from src to dst
+	void copy(VkCommandBuffer cbuf, VkBuffer src, VkBuffer dst, VkDeviceSize size,
+		  VkDeviceSize src_offset = 0, VkDeviceSize dst_offset = 0);
+
+	// Records a barrier making earlier writes by src_stage visible to
+	// dst_access in dst_stage and later
+	void barrier(VkCommandBuffer cbuf, VkBuffer buffer,
+		     VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+		     VkPipelineStageFlags dst_stage, VkAccessFlags dst_access,
+		     VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+	// Exclusive buffers used by queues of two different families (e.g.
+	// graphics and async compute) have to change owners. Record the
+	// release on a src_fam queue and the acquire, with the same range, on
+	// a dst_fam queue, and have a semaphore order the two submissions.
+	void release(VkCommandBuffer cbuf, VkBuffer buffer, uint32_t src_fam, uint32_t dst_fam,
+		     VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+		     VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+	void acquire(VkCommandBuffer cbuf, VkBuffer buffer, uint32_t src_fam, uint32_t dst_fam,
+		     VkPipelineStageFlags dst_stage, VkAccessFlags dst_access,
+		     VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+}
+
+#endif // LL_BUFFER_H
@@ -3,6 +3,71 @@
 #include <stdexcept>
 
 namespace ll::cbuf {
+	auto pool(VkDevice device, uint32_t queue_fam, VkCommandPoolCreateFlags flags) -> VkCommandPool {
+		VkCommandPoolCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		info.queueFamilyIndex = queue_fam;
+		info.flags = flags;
+
+		VkCommandPool pool{};
+		if (vkCreateCommandPool(device, &info, nullptr, &pool) != VK_SUCCESS)
+			throw std::runtime_error("Could not create command pool!");
+
+		return pool;
+	}
+
+	auto allocate(VkDevice device, VkCommandPool pool, uint32_t cbuf_ct, VkCommandBufferLevel level)
+		-> std::vector<VkCommandBuffer>
+	{
+		VkCommandBufferAllocateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		info.commandPool = pool;
+		info.level = level;
+		info.commandBufferCount = cbuf_ct;
+
+		std::vector<VkCommandBuffer> cbufs(cbuf_ct);
+		if (vkAllocateCommandBuffers(device, &info, cbufs.data()) != VK_SUCCESS)
+			throw std::runtime_error("Could not allocate command buffers!");
+
+		return cbufs;
+	}
+
+	FrameAllocator::FrameAllocator(VkDevice device, uint32_t queue_fam, uint32_t frame_ct)
+		: device(device)
+	{
+		if (frame_ct == 0) throw std::runtime_error("Need at least one frame in flight!");
+
+		for (uint32_t i = 0; i < frame_ct; ++i)
+			frames.push_back({pool(device, queue_fam, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT), {}, {}, 0, 0});
+	}
+
+	FrameAllocator::~FrameAllocator() {
+		// Destroying a pool frees its buffers
+		for (auto& frame : frames) vkDestroyCommandPool(device, frame.pool, nullptr);
+	}
+
+	void FrameAllocator::begin_frame(uint32_t idx) {
+		if (idx >= frames.size()) throw std::runtime_error("Frame index out of range!");
+		frame_idx = idx;
+
+		auto& frame = frames[frame_idx];
+		if (vkResetCommandPool(device, frame.pool, 0) != VK_SUCCESS)
+			throw std::runtime_error("Could not reset command pool!");
+		frame.primaries_used = 0;
+		frame.secondaries_used = 0;
+	}
+
+	auto FrameAllocator::get(VkCommandBufferLevel level) -> VkCommandBuffer {
+		auto& frame = frames[frame_idx];
+		auto secondary = level == VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		auto& cbufs = secondary ? frame.secondaries : frame.primaries;
+		auto& used = secondary ? frame.secondaries_used : frame.primaries_used;
+
+		if (used == cbufs.size()) cbufs.push_back(allocate(device, frame.pool, 1, level)[0]);
+
+		return cbufs[used++];
+	}
+
 	void begin(VkCommandBuffer cbuf, VkCommandBufferUsageFlags flags) {
 		VkCommandBufferBeginInfo cbuf_begin{};
 		cbuf_begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -13,8 +78,27 @@ namespace ll::cbuf {
 		}
 	}
 
+	void begin_secondary(VkCommandBuffer cbuf, VkRenderPass rpass, uint32_t subpass, VkFramebuffer fb,
+			     VkCommandBufferUsageFlags flags)
+	{
+		VkCommandBufferInheritanceInfo inheritance{};
+		inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance.renderPass = rpass;
+		inheritance.subpass = subpass;
+		inheritance.framebuffer = fb;
+
+		VkCommandBufferBeginInfo cbuf_begin{};
+		cbuf_begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		cbuf_begin.flags = flags | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		cbuf_begin.pInheritanceInfo = &inheritance;
+
+		if (vkBeginCommandBuffer(cbuf, &cbuf_begin) != VK_SUCCESS)
+			throw std::runtime_error("Could not begin secondary command buffer!");
+	}
+
 	void begin_rpass(VkCommandBuffer cbuf, VkRenderPass rpass,
-			 VkFramebuffer fb, uint32_t width, uint32_t height)
+			 VkFramebuffer fb, uint32_t width, uint32_t height,
+			 VkSubpassContents contents)
 	{
 		VkRenderPassBeginInfo cbuf_rpass_info{};
 		cbuf_rpass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -26,7 +110,23 @@ namespace ll::cbuf {
 		VkClearValue clear_val = {0.0F, 0.0F, 0.0F, 0.0F};
 		cbuf_rpass_info.clearValueCount = 1;
 		cbuf_rpass_info.pClearValues = &clear_val;
-		vkCmdBeginRenderPass(cbuf, &cbuf_rpass_info, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(cbuf, &cbuf_rpass_info, contents);
+	}
+
+	void begin_rpass(VkCommandBuffer cbuf, VkRenderPass rpass,
+			 VkFramebuffer fb, uint32_t width, uint32_t height,
+			 const std::vector<VkClearValue>& clear_values, VkSubpassContents contents)
+	{
+		VkRenderPassBeginInfo cbuf_rpass_info{};
+		cbuf_rpass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		cbuf_rpass_info.renderPass = rpass;
+		cbuf_rpass_info.framebuffer = fb;
+		cbuf_rpass_info.renderArea.offset = {0, 0};
+		cbuf_rpass_info.renderArea.extent.width = width;
+		cbuf_rpass_info.renderArea.extent.height = height;
+		cbuf_rpass_info.clearValueCount = clear_values.size();
+		cbuf_rpass_info.pClearValues = clear_values.data();
+		vkCmdBeginRenderPass(cbuf, &cbuf_rpass_info, contents);
 	}
 
 	void bind_pipeline(VkCommandBuffer cbuf,
@@ -35,6 +135,21 @@ namespace ll::cbuf {
 		vkCmdBindPipeline(cbuf, point, pipeline);
 	}
 
+	void bind_descriptor_sets(VkCommandBuffer cbuf, VkPipelineLayout layout,
+				  const std::vector<VkDescriptorSet>& sets,
+				  VkPipelineBindPoint point, uint32_t first_set,
+				  const std::vector<uint32_t>& dynamic_offsets)
+	{
+		vkCmdBindDescriptorSets(cbuf, point, layout, first_set, sets.size(), sets.data(),
+					dynamic_offsets.size(), dynamic_offsets.data());
+	}
+
+	void push_constants(VkCommandBuffer cbuf, VkPipelineLayout layout, VkShaderStageFlags stages,
+			    uint32_t offset, uint32_t size, const void* data)
+	{
+		vkCmdPushConstants(cbuf, layout, stages, offset, size, data);
+	}
+
 	void set_viewport(VkCommandBuffer cbuf, const std::vector<VkViewport>& viewports) {
 		vkCmdSetViewport(cbuf, 0, viewports.size(), viewports.data());
 	}
@@ -43,15 +158,119 @@ namespace ll::cbuf {
 		vkCmdSetScissor(cbuf, 0, scissors.size(), scissors.data());
 	}
 
+	void bind_vertex_buffers(VkCommandBuffer cbuf, const std::vector<VkBuffer>& buffers,
+				 const std::vector<VkDeviceSize>& offsets, uint32_t first_binding)
+	{
+		if (buffers.size() != offsets.size())
+			throw std::runtime_error("Need exactly one offset per vertex buffer!");
+		vkCmdBindVertexBuffers(cbuf, first_binding, buffers.size(), buffers.data(), offsets.data());
+	}
+
+	void bind_index_buffer(VkCommandBuffer cbuf, VkBuffer buffer, VkIndexType type, VkDeviceSize offset) {
+		vkCmdBindIndexBuffer(cbuf, buffer, offset, type);
+	}
+
 	void draw(VkCommandBuffer cbuf, uint32_t vertex_ct,
 		  uint32_t instance_ct, uint32_t first_vertex, uint32_t first_instance)
 	{
 		vkCmdDraw(cbuf, vertex_ct, instance_ct, first_vertex, first_instance);
 	}
 
+	void draw_indexed(VkCommandBuffer cbuf, uint32_t index_ct,
+			  uint32_t instance_ct, uint32_t first_index,
+			  int32_t vertex_offset, uint32_t first_instance)
+	{
+		vkCmdDrawIndexed(cbuf, index_ct, instance_ct, first_index, vertex_offset, first_instance);
+	}
+
+	void draw_indexed_indirect(VkCommandBuffer cbuf, VkBuffer buffer, VkDeviceSize offset, uint32_t draw_ct,
+				   uint32_t stride)
+	{
+		vkCmdDrawIndexedIndirect(cbuf, buffer, offset, draw_ct, stride);
+	}
+
+	void draw_indexed_indirect_count(VkCommandBuffer cbuf, VkBuffer buffer, VkDeviceSize offset,
+					 VkBuffer count_buffer, VkDeviceSize count_offset, uint32_t max_draw_ct,
+					 uint32_t stride)
+	{
+		vkCmdDrawIndexedIndirectCount(cbuf, buffer, offset, count_buffer, count_offset, max_draw_ct, stride);
+	}
+
 	void end_rpass(VkCommandBuffer cbuf) {
 		vkCmdEndRenderPass(cbuf);
+	}
+
+	auto rendering_attachment(VkImageView view, VkImageLayout layout,
+				  VkAttachmentLoadOp load, VkAttachmentStoreOp store, VkClearValue clear,
+				  VkImageView resolve_view, VkResolveModeFlagBits resolve_mode)
+		-> VkRenderingAttachmentInfo
+	{
+		VkRenderingAttachmentInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		info.imageView = view;
+		info.imageLayout = layout;
+		info.loadOp = load;
+		info.storeOp = store;
+		info.clearValue = clear;
+		if (resolve_view != VK_NULL_HANDLE) {
+			info.resolveMode = resolve_mode;
+			info.resolveImageView = resolve_view;
+			info.resolveImageLayout = layout;
+		}
+
+		return info;
+	}
+
+	void begin_rendering(VkCommandBuffer cbuf, uint32_t width, uint32_t height,
+			     const std::vector<VkRenderingAttachmentInfo>& colors,
+			     const VkRenderingAttachmentInfo* depth, const VkRenderingAttachmentInfo* stencil,
+			     VkRenderingFlags flags)
+	{
+		VkRenderingInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		info.flags = flags;
+		info.renderArea.offset = {0, 0};
+		info.renderArea.extent.width = width;
+		info.renderArea.extent.height = height;
+		info.layerCount = 1;
+		info.colorAttachmentCount = colors.size();
+		info.pColorAttachments = colors.data();
+		info.pDepthAttachment = depth;
+		info.pStencilAttachment = stencil;
+		vkCmdBeginRendering(cbuf, &info);
+	}
+
+	void end_rendering(VkCommandBuffer cbuf) {
+		vkCmdEndRendering(cbuf);
+	}
+
+	void execute(VkCommandBuffer cbuf, const std::vector<VkCommandBuffer>& secondaries) {
+		if (secondaries.empty()) return;
+		vkCmdExecuteCommands(cbuf, secondaries.size(), secondaries.data());
+	}
+
+	void end(VkCommandBuffer cbuf) {
 		if (vkEndCommandBuffer(cbuf) != VK_SUCCESS)
 			throw std::runtime_error("Could not end command buffer!");
 	}
+
+	void dispatch(VkCommandBuffer cbuf, uint32_t group_ct_x, uint32_t group_ct_y, uint32_t group_ct_z) {
+		vkCmdDispatch(cbuf, group_ct_x, group_ct_y, group_ct_z);
+	}
+
+	void dispatch_indirect(VkCommandBuffer cbuf, VkBuffer buffer, VkDeviceSize offset) {
+		vkCmdDispatchIndirect(cbuf, buffer, offset);
+	}
+
+	void memory_barrier(VkCommandBuffer cbuf,
+			    VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+			    VkPipelineStageFlags dst_stage, VkAccessFlags dst_access)
+	{
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = src_access;
+		barrier.dstAccessMask = dst_access;
+
+		vkCmdPipelineBarrier(cbuf, src_stage, dst_stage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
 }
@@ -5,22 +5,165 @@
 #include <vector>
 
 namespace ll::cbuf {
+	auto pool(VkDevice device, uint32_t queue_fam, VkCommandPoolCreateFlags flags = 0) -> VkCommandPool;
+
+	auto allocate(VkDevice device, VkCommandPool pool, uint32_t cbuf_ct,
+		      VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY)
+		-> std::vector<VkCommandBuffer>;
+
+	// Gives every frame in flight its own transient command pool. Instead
+	// of resetting buffers one by one, begin_frame() resets the frame's
+	// whole pool at once and get() hands its buffers out again.
+	//
+	// Not thread-safe: use one allocator per recording thread.
+	struct FrameAllocator {
+		FrameAllocator(VkDevice device, uint32_t queue_fam, uint32_t frame_ct);
+		~FrameAllocator();
+
+		FrameAllocator(const FrameAllocator&) = delete;
+		auto operator=(const FrameAllocator&) -> FrameAllocator& = delete;
+
+		// Only call once the GPU is done with everything allocated the
+		// last time this frame index came around, e.g. after waiting
+		// on the frame's fence
+		void begin_frame(uint32_t frame_idx);
+
+		// Returns a command buffer in the initial state, valid until
+		// the current frame index comes around again
+		auto get(VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY) -> VkCommandBuffer;
+
+	private:
+		struct FramePool {
+			VkCommandPool pool;
+			// Everything ever allocated from the pool, the first
+			// *_used are handed out this time around
+			std::vector<VkCommandBuffer> primaries;
+			std::vector<VkCommandBuffer> secondaries;
+			size_t primaries_used;
+			size_t secondaries_used;
+		};
+
+		VkDevice device;
+		std::vector<FramePool> frames;
+		uint32_t frame_idx = 0;
+	};
+
 	void begin(VkCommandBuffer cbuf, VkCommandBufferUsageFlags flags = 0);
 
+	// Begins a secondary command buffer that will be executed inside the
+	// given subpass. Fb may be VK_NULL_HANDLE if it isn't known yet.
+	void begin_secondary(VkCommandBuffer cbuf, VkRenderPass rpass, uint32_t subpass, VkFramebuffer fb,
+			     VkCommandBufferUsageFlags flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	void end(VkCommandBuffer cbuf);
+
 	void begin_rpass(VkCommandBuffer cbuf, VkRenderPass rpass,
-			 VkFramebuffer fb, uint32_t width, uint32_t height);
+			 VkFramebuffer fb, uint32_t width, uint32_t height,
+			 VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+
+	// One clear value per attachment, only used by the ones with
+	// VK_ATTACHMENT_LOAD_OP_CLEAR. The overload above clears the first
+	// attachment to zero.
+	void begin_rpass(VkCommandBuffer cbuf, VkRenderPass rpass,
+			 VkFramebuffer fb, uint32_t width, uint32_t height,
+			 const std::vector<VkClearValue>& clear_values,
+			 VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 
 	void end_rpass(VkCommandBuffer cbuf);
 
+	// One attachment of begin_rendering(). If resolve_view is set, the
+	// (multisampled) view is resolved into it at the end of rendering.
+	auto rendering_attachment(VkImageView view, VkImageLayout layout,
+				  VkAttachmentLoadOp load, VkAttachmentStoreOp store, VkClearValue clear = {},
+				  VkImageView resolve_view = VK_NULL_HANDLE,
+				  VkResolveModeFlagBits resolve_mode = VK_RESOLVE_MODE_AVERAGE_BIT)
+		-> VkRenderingAttachmentInfo;
+
+	// Dynamic rendering, the alternative to begin_rpass() that needs no
+	// render pass or framebuffer. Pipelines have to be created against
+	// the attachments' formats instead. There are no layout transitions,
+	// the attachments have to be in their layouts already. Depth and
+	// stencil may be null.
+	void begin_rendering(VkCommandBuffer cbuf, uint32_t width, uint32_t height,
+			     const std::vector<VkRenderingAttachmentInfo>& colors,
+			     const VkRenderingAttachmentInfo* depth = nullptr,
+			     const VkRenderingAttachmentInfo* stencil = nullptr,
+			     VkRenderingFlags flags = 0);
+
+	void end_rendering(VkCommandBuffer cbuf);
+
+	// Secondary command buffers can only be executed in a render pass
+	// begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+	void execute(VkCommandBuffer cbuf, const std::vector<VkCommandBuffer>& secondaries);
+
 	void bind_pipeline(VkCommandBuffer cbuf,
 			   VkPipeline pipeline, VkPipelineBindPoint point = VK_PIPELINE_BIND_POINT_GRAPHICS);
 
+	void bind_descriptor_sets(VkCommandBuffer cbuf, VkPipelineLayout layout,
+				  const std::vector<VkDescriptorSet>& sets,
+				  VkPipelineBindPoint point = VK_PIPELINE_BIND_POINT_GRAPHICS,
+				  uint32_t first_set = 0, const std::vector<uint32_t>& dynamic_offsets = {});
+
+	// Stages must match the layout's range(s) covering [offset, offset
+	// + size)
+	void push_constants(VkCommandBuffer cbuf, VkPipelineLayout layout, VkShaderStageFlags stages,
+			    uint32_t offset, uint32_t size, const void* data);
+
+	template <typename T>
+	void push_constants(VkCommandBuffer cbuf, VkPipelineLayout layout, VkShaderStageFlags stages,
+			    const T& data, uint32_t offset = 0) {
+		push_constants(cbuf, layout, stages, offset, sizeof(T), &data);
+	}
+
 	void set_viewport(VkCommandBuffer cbuf, const std::vector<VkViewport>& viewports);
 
 	void set_scissor(VkCommandBuffer cbuf, const std::vector<VkRect2D>& scissors);
 
+	void bind_vertex_buffers(VkCommandBuffer cbuf, const std::vector<VkBuffer>& buffers,
+				 const std::vector<VkDeviceSize>& offsets, uint32_t first_binding = 0);
+
+	void bind_index_buffer(VkCommandBuffer cbuf, VkBuffer buffer,
+			       VkIndexType type = VK_INDEX_TYPE_UINT32, VkDeviceSize offset = 0);
+
 	void draw(VkCommandBuffer cbuf, uint32_t vertex_ct,
 		  uint32_t instance_ct = 1, uint32_t first_vertex = 0, uint32_t first_instance = 0);
+
+	void draw_indexed(VkCommandBuffer cbuf, uint32_t index_ct,
+			  uint32_t instance_ct = 1, uint32_t first_index = 0,
+			  int32_t vertex_offset = 0, uint32_t first_instance = 0);
+
+	// Buffer holds draw_ct VkDrawIndexedIndirectCommands, stride bytes
+	// apart. Draw_ct > 1 needs the multiDrawIndirect feature.
+	void draw_indexed_indirect(VkCommandBuffer cbuf, VkBuffer buffer, VkDeviceSize offset, uint32_t draw_ct,
+				   uint32_t stride = sizeof(VkDrawIndexedIndirectCommand));
+
+	// Like draw_indexed_indirect(), but the number of draws is read from
+	// count_buffer on the GPU (and clamped to max_draw_ct), so a compute
+	// pass can decide it. Needs the drawIndirectCount feature.
+	void draw_indexed_indirect_count(VkCommandBuffer cbuf, VkBuffer buffer, VkDeviceSize offset,
+					 VkBuffer count_buffer, VkDeviceSize count_offset, uint32_t max_draw_ct,
+					 uint32_t stride = sizeof(VkDrawIndexedIndirectCommand));
+
+	// How many workgroups of group_size it takes to cover item_ct items.
+	// The shader has to skip the invocations past the end.
+	inline auto group_ct(uint32_t item_ct, uint32_t group_size) -> uint32_t {
+		return (item_ct + group_size - 1) / group_size;
+	}
+
+	void dispatch(VkCommandBuffer cbuf, uint32_t group_ct_x, uint32_t group_ct_y = 1, uint32_t group_ct_z = 1);
+
+	// Buffer holds a VkDispatchIndirectCommand at offset, e.g. written by
+	// an earlier compute pass. Needs VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+	// and a barrier to VK_ACCESS_INDIRECT_COMMAND_READ_BIT in
+	// VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT.
+	void dispatch_indirect(VkCommandBuffer cbuf, VkBuffer buffer, VkDeviceSize offset = 0);
+
+	// Records a global memory barrier, which covers every buffer and
+	// image at once. Between compute passes this is usually cheaper to
+	// record than a barrier per resource, and no slower on the GPU.
+	void memory_barrier(VkCommandBuffer cbuf,
+			    VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+			    VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
 }
 
 #endif // LL_CBUF_H
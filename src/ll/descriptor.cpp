@@ -0,0 +1,248 @@
+#include "descriptor.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ll::descriptor {
+	auto binding(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages, uint32_t count)
+		-> VkDescriptorSetLayoutBinding
+	{
+		VkDescriptorSetLayoutBinding out{};
+		out.binding = binding;
+		out.descriptorType = type;
+		out.descriptorCount = count;
+		out.stageFlags = stages;
+
+		return out;
+	}
+
+	auto layout(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+		    VkDescriptorSetLayoutCreateFlags flags,
+		    const std::vector<VkDescriptorBindingFlags>& binding_flags) -> VkDescriptorSetLayout
+	{
+		if (!binding_flags.empty() && binding_flags.size() != bindings.size())
+			throw std::runtime_error("Need flags for every binding or none!");
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info{};
+		flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		flags_info.bindingCount = binding_flags.size();
+		flags_info.pBindingFlags = binding_flags.data();
+
+		VkDescriptorSetLayoutCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		info.pNext = binding_flags.empty() ? nullptr : &flags_info;
+		info.flags = flags;
+		info.bindingCount = bindings.size();
+		info.pBindings = bindings.data();
+
+		VkDescriptorSetLayout layout{};
+		if (vkCreateDescriptorSetLayout(device, &info, nullptr, &layout) != VK_SUCCESS)
+			throw std::runtime_error("Could not create descriptor set layout!");
+
+		return layout;
+	}
+
+	auto pool(VkDevice device, uint32_t max_sets, const std::vector<VkDescriptorPoolSize>& sizes,
+		  VkDescriptorPoolCreateFlags flags) -> VkDescriptorPool
+	{
+		VkDescriptorPoolCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		info.flags = flags;
+		info.maxSets = max_sets;
+		info.poolSizeCount = sizes.size();
+		info.pPoolSizes = sizes.data();
+
+		VkDescriptorPool pool{};
+		if (vkCreateDescriptorPool(device, &info, nullptr, &pool) != VK_SUCCESS)
+			throw std::runtime_error("Could not create descriptor pool!");
+
+		return pool;
+	}
+
+	// Returns VK_NULL_HANDLE if the pool is full
+	static auto try_allocate(VkDevice device, VkDescriptorPool pool, VkDescriptorSetLayout layout)
+		-> VkDescriptorSet
+	{
+		VkDescriptorSetAllocateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		info.descriptorPool = pool;
+		info.descriptorSetCount = 1;
+		info.pSetLayouts = &layout;
+
+		VkDescriptorSet set{};
+		auto res = vkAllocateDescriptorSets(device, &info, &set);
+		if (res == VK_ERROR_OUT_OF_POOL_MEMORY || res == VK_ERROR_FRAGMENTED_POOL) return VK_NULL_HANDLE;
+		if (res != VK_SUCCESS) throw std::runtime_error("Could not allocate descriptor set!");
+
+		return set;
+	}
+
+	auto allocate(VkDevice device, VkDescriptorPool pool, VkDescriptorSetLayout layout) -> VkDescriptorSet {
+		auto set = try_allocate(device, pool, layout);
+		if (set == VK_NULL_HANDLE) throw std::runtime_error("Descriptor pool is full!");
+
+		return set;
+	}
+
+	/*
+	 * LayoutCache
+	 */
+	LayoutCache::LayoutCache(VkDevice device) : device(device) {}
+
+	LayoutCache::~LayoutCache() {
+		for (auto& [key, layout] : layouts) vkDestroyDescriptorSetLayout(device, layout, nullptr);
+	}
+
+	auto LayoutCache::get(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+			      VkDescriptorSetLayoutCreateFlags flags) -> VkDescriptorSetLayout
+	{
+		Key key;
+		key.second = flags;
+		for (const auto& b : bindings)
+			key.first.emplace_back(b.binding, b.descriptorType, b.descriptorCount, b.stageFlags);
+		std::sort(key.first.begin(), key.first.end());
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto existing = layouts.find(key);
+		if (existing != layouts.end()) return existing->second;
+
+		auto created = layout(device, bindings, flags);
+		layouts.emplace(std::move(key), created);
+
+		return created;
+	}
+
+	auto LayoutCache::size() const -> size_t {
+		std::lock_guard<std::mutex> lock(mutex);
+		return layouts.size();
+	}
+
+	/*
+	 * FrameAllocator
+	 */
+	FrameAllocator::FrameAllocator(VkDevice device, uint32_t frame_ct,
+				       const std::vector<VkDescriptorPoolSize>& pool_sizes, uint32_t sets_per_pool)
+		: device(device), sizes(pool_sizes), sets_per_pool(sets_per_pool), frames(frame_ct)
+	{
+		if (frame_ct == 0) throw std::runtime_error("Need at least one frame in flight!");
+
+		for (auto& size : sizes) size.descriptorCount *= sets_per_pool;
+	}
+
+	FrameAllocator::~FrameAllocator() {
+		for (auto& frame : frames)
+			for (auto pool : frame) vkDestroyDescriptorPool(device, pool, nullptr);
+		for (auto pool : free_pools) vkDestroyDescriptorPool(device, pool, nullptr);
+	}
+
+	void FrameAllocator::begin_frame(uint32_t idx) {
+		if (idx >= frames.size()) throw std::runtime_error("Frame index out of range!");
+		frame_idx = idx;
+
+		// Resetting frees every set in the pool at once
+		for (auto pool : frames[frame_idx]) {
+			if (vkResetDescriptorPool(device, pool, 0) != VK_SUCCESS)
+				throw std::runtime_error("Could not reset descriptor pool!");
+			free_pools.push_back(pool);
+		}
+		frames[frame_idx].clear();
+	}
+
+	auto FrameAllocator::next_pool() -> VkDescriptorPool {
+		if (!free_pools.empty()) {
+			auto pool = free_pools.back();
+			free_pools.pop_back();
+			return pool;
+		}
+
+		total_pool_ct++;
+		return descriptor::pool(device, sets_per_pool, sizes);
+	}
+
+	auto FrameAllocator::allocate(VkDescriptorSetLayout layout) -> VkDescriptorSet {
+		auto& pools = frames[frame_idx];
+
+		if (!pools.empty()) {
+			auto set = try_allocate(device, pools.back(), layout);
+			if (set != VK_NULL_HANDLE) return set;
+		}
+
+		// A fresh pool failing means the layout needs more
+		// descriptors than a whole pool has
+		pools.push_back(next_pool());
+		auto set = try_allocate(device, pools.back(), layout);
+		if (set == VK_NULL_HANDLE) throw std::runtime_error("Descriptor set doesn't fit in a pool!");
+
+		return set;
+	}
+
+	auto FrameAllocator::pool_ct() const -> size_t {
+		return total_pool_ct;
+	}
+
+	/*
+	 * Writer
+	 */
+	static auto uses_image_info(VkDescriptorType type) -> bool {
+		return type == VK_DESCRIPTOR_TYPE_SAMPLER
+			|| type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+			|| type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
+			|| type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+			|| type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+	}
+
+	static auto make_write(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, uint32_t array_element)
+		-> VkWriteDescriptorSet
+	{
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = binding;
+		write.dstArrayElement = array_element;
+		write.descriptorCount = 1;
+		write.descriptorType = type;
+
+		return write;
+	}
+
+	void Writer::buffer(VkDescriptorSet set, uint32_t binding, VkDescriptorType type,
+			    VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t array_element)
+	{
+		if (uses_image_info(type)) throw std::runtime_error("Not a buffer descriptor type!");
+		if (type == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER)
+			throw std::runtime_error("Texel buffers aren't supported!");
+
+		buffer_infos.push_back({buffer, offset, range});
+		writes.push_back(make_write(set, binding, type, array_element));
+	}
+
+	void Writer::image(VkDescriptorSet set, uint32_t binding, VkDescriptorType type,
+			   VkSampler sampler, VkImageView view, VkImageLayout layout, uint32_t array_element)
+	{
+		if (!uses_image_info(type)) throw std::runtime_error("Not an image descriptor type!");
+
+		image_infos.push_back({sampler, view, layout});
+		writes.push_back(make_write(set, binding, type, array_element));
+	}
+
+	void Writer::flush(VkDevice device) {
+		if (writes.empty()) return;
+
+		// The infos were queued in the same order as their writes
+		size_t buffer_idx = 0, image_idx = 0;
+		for (auto& write : writes) {
+			if (uses_image_info(write.descriptorType)) write.pImageInfo = &image_infos[image_idx++];
+			else write.pBufferInfo = &buffer_infos[buffer_idx++];
+		}
+
+		vkUpdateDescriptorSets(device, writes.size(), writes.data(), 0, nullptr);
+
+		writes.clear();
+		buffer_infos.clear();
+		image_infos.clear();
+	}
+
+	auto Writer::empty() const -> bool {
+		return writes.empty();
+	}
+}
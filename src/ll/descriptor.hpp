@@ -0,0 +1,141 @@
+#ifndef LL_DESCRIPTOR_H
+#define LL_DESCRIPTOR_H
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace ll::descriptor {
+	auto binding(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages, uint32_t count = 1)
+		-> VkDescriptorSetLayoutBinding;
+
+	// Immutable samplers aren't supported, pImmutableSamplers is ignored.
+	// Binding_flags is either empty or has one entry per binding, e.g.
+	// for descriptor indexing (Vulkan 1.2).
+	auto layout(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+		    VkDescriptorSetLayoutCreateFlags flags = 0,
+		    const std::vector<VkDescriptorBindingFlags>& binding_flags = {}) -> VkDescriptorSetLayout;
+
+	auto pool(VkDevice device, uint32_t max_sets, const std::vector<VkDescriptorPoolSize>& sizes,
+		  VkDescriptorPoolCreateFlags flags = 0) -> VkDescriptorPool;
+
+	// Throws if the pool is full, use FrameAllocator for sets that
+	// change every frame
+	auto allocate(VkDevice device, VkDescriptorPool pool, VkDescriptorSetLayout layout) -> VkDescriptorSet;
+
+	// Hands out one VkDescriptorSetLayout per distinct set of bindings
+	// (and flags), so every pipeline describing the same interface shares
+	// a layout. Layouts live as long as the cache.
+	//
+	// Thread-safe, so pipelines can be described on several threads.
+	struct LayoutCache {
+		explicit LayoutCache(VkDevice device);
+		~LayoutCache();
+
+		LayoutCache(const LayoutCache&) = delete;
+		auto operator=(const LayoutCache&) -> LayoutCache& = delete;
+
+		// The order of bindings doesn't matter
+		auto get(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+			 VkDescriptorSetLayoutCreateFlags flags = 0) -> VkDescriptorSetLayout;
+
+		auto size() const -> size_t;
+
+	private:
+		// (binding, type, count, stages) for each binding, sorted by
+		// binding, then the flags
+		using Key = std::pair<std::vector<std::tuple<uint32_t, VkDescriptorType, uint32_t, VkShaderStageFlags>>,
+				      VkDescriptorSetLayoutCreateFlags>;
+
+		VkDevice device;
+		std::map<Key, VkDescriptorSetLayout> layouts;
+		mutable std::mutex mutex;
+	};
+
+	// Descriptors per pool, relative to DEFAULT_SETS_PER_POOL
+	const std::vector<VkDescriptorPoolSize> DEFAULT_POOL_SIZES {
+		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2},
+		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1},
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2},
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
+		{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1},
+		{VK_DESCRIPTOR_TYPE_SAMPLER, 1},
+		{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1}
+	};
+	const uint32_t DEFAULT_SETS_PER_POOL = 256;
+
+	// Descriptor sets that only live for one frame. Every frame in flight
+	// has its own list of pools, which are all reset at once in
+	// begin_frame() instead of freeing sets one by one. When a pool runs
+	// out, another one is taken from a shared free list (or created), so
+	// after a few frames nothing is allocated from the driver anymore.
+	//
+	// Not thread-safe, use one per recording thread.
+	struct FrameAllocator {
+		// Pool_sizes are per set, every pool can hold sets_per_pool
+		// sets with that many descriptors each
+		FrameAllocator(VkDevice device, uint32_t frame_ct,
+			       const std::vector<VkDescriptorPoolSize>& pool_sizes = DEFAULT_POOL_SIZES,
+			       uint32_t sets_per_pool = DEFAULT_SETS_PER_POOL);
+		~FrameAllocator();
+
+		FrameAllocator(const FrameAllocator&) = delete;
+		auto operator=(const FrameAllocator&) -> FrameAllocator& = delete;
+
+		// Only call once the GPU is done with everything allocated the
+		// last time this frame index came around
+		void begin_frame(uint32_t frame_idx);
+
+		// Valid until the current frame index comes around again
+		auto allocate(VkDescriptorSetLayout layout) -> VkDescriptorSet;
+
+		// Pools created so far, across all frames
+		auto pool_ct() const -> size_t;
+
+	private:
+		VkDevice device;
+		std::vector<VkDescriptorPoolSize> sizes;
+		uint32_t sets_per_pool;
+
+		// The last pool of each frame is the one being allocated from
+		std::vector<std::vector<VkDescriptorPool>> frames;
+		std::vector<VkDescriptorPool> free_pools;
+		size_t total_pool_ct = 0;
+		uint32_t frame_idx = 0;
+
+		auto next_pool() -> VkDescriptorPool;
+	};
+
+	// Collects descriptor writes and submits them with a single
+	// vkUpdateDescriptorSets() call, rather than one per set or binding.
+	// The infos are copied, so the arguments don't have to outlive the
+	// call. Texel buffers aren't supported.
+	struct Writer {
+		void buffer(VkDescriptorSet set, uint32_t binding, VkDescriptorType type,
+			    VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE,
+			    uint32_t array_element = 0);
+
+		// Sampler and/or view can be VK_NULL_HANDLE depending on type
+		void image(VkDescriptorSet set, uint32_t binding, VkDescriptorType type,
+			   VkSampler sampler, VkImageView view, VkImageLayout layout,
+			   uint32_t array_element = 0);
+
+		// Writes everything queued so far and clears the queue
+		void flush(VkDevice device);
+
+		auto empty() const -> bool;
+
+	private:
+		// Only one of these is used by each write. Kept in separate
+		// vectors so writes can point into them once nothing moves
+		// anymore, in flush().
+		std::vector<VkDescriptorBufferInfo> buffer_infos;
+		std::vector<VkDescriptorImageInfo> image_infos;
+		std::vector<VkWriteDescriptorSet> writes;
+	};
+}
+
+#endif // LL_DESCRIPTOR_H
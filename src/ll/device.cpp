@@ -25,13 +25,14 @@ namespace ll::device {
 		    std::vector<VkDeviceQueueCreateInfo> queue_infos,
 		    VkPhysicalDeviceFeatures req_features,
 		    const std::vector<const char *>& req_extensions,
-		    VkDevice* device)
+		    VkDevice* device, const void* next)
 	{
 		if (!check_extension_support(phys_dev, req_extensions))
 			throw std::runtime_error("Required device extensions not supported!");
 
 		VkDeviceCreateInfo device_info{};
 		device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		device_info.pNext = next;
 		device_info.queueCreateInfoCount = static_cast<uint32_t>(queue_infos.size());
 		device_info.pQueueCreateInfos = queue_infos.data();
 		device_info.pEnabledFeatures = &req_features;
@@ -2,21 +2,33 @@
 #define LL_DEVICE_H
 
 #include <algorithm>
+#include <array>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 #include <vulkan/vulkan.h>
 
 namespace ll::device {
 	const float DEFAULT_QUEUE_PRIORITY = 1.0F;
+	// The most queues default_queue_infos() will create from one family
+	const uint32_t MAX_QUEUES_PER_FAMILY = 4;
+	const std::array<float, MAX_QUEUES_PER_FAMILY> DEFAULT_QUEUE_PRIORITIES {
+		DEFAULT_QUEUE_PRIORITY, DEFAULT_QUEUE_PRIORITY, DEFAULT_QUEUE_PRIORITY, DEFAULT_QUEUE_PRIORITY
+	};
 
-	// Req_features is currently unimplemented
+	// Next is put in VkDeviceCreateInfo's pNext, e.g. to enable newer
+	// features through VkPhysicalDeviceVulkan12Features
 	void create(VkPhysicalDevice phys_dev,
 		    std::vector<VkDeviceQueueCreateInfo> queue_infos,
 		    VkPhysicalDeviceFeatures req_features,
 		    const std::vector<const char *>& req_extensions,
-		    VkDevice* device);
+		    VkDevice* device, const void* next = nullptr);
 
 	// Generates a vector of VkDeviceQueueCreateInfo from a list of queue
-	// families that can be used to create a device.
+	// families that can be used to create a device. Elements are either
+	// family indices, which get one queue each, or (family, queue count)
+	// pairs like the ones from QueueFamilies::device_queues().
         template <class InputIt>
         auto default_queue_infos(InputIt start, InputIt stop) -> std::vector<VkDeviceQueueCreateInfo> {
 		std::vector<VkDeviceQueueCreateInfo> queue_infos;
@@ -24,9 +36,16 @@ namespace ll::device {
 		for (; start != stop; ++start) {
 			VkDeviceQueueCreateInfo info{};
 			info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-			info.queueCount = 1;
-			info.queueFamilyIndex = *start;
-			info.pQueuePriorities = &DEFAULT_QUEUE_PRIORITY;
+			if constexpr (std::is_integral_v<typename std::iterator_traits<InputIt>::value_type>) {
+				info.queueFamilyIndex = *start;
+				info.queueCount = 1;
+			} else {
+				info.queueFamilyIndex = start->first;
+				info.queueCount = start->second;
+			}
+			if (info.queueCount > MAX_QUEUES_PER_FAMILY)
+				throw std::runtime_error("Too many queues requested from one family!");
+			info.pQueuePriorities = DEFAULT_QUEUE_PRIORITIES.data();
 			queue_infos.push_back(info);
 		}
 
@@ -12,6 +12,51 @@ namespace ll::image {
 		return images;
 	}
 
+	auto aspect(VkFormat format) -> VkImageAspectFlags {
+		switch (format) {
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		case VK_FORMAT_S8_UINT:
+			return VK_IMAGE_ASPECT_STENCIL_BIT;
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+
+	auto range(VkFormat format) -> VkImageSubresourceRange {
+		auto range = IMAGE_VIEW_DEFAULTS.subresource_range;
+		range.aspectMask = aspect(format);
+		return range;
+	}
+
+	auto depth_format(VkPhysicalDevice phys_dev, const std::vector<VkFormat>& candidates) -> VkFormat {
+		for (auto format : candidates) {
+			VkFormatProperties props;
+			vkGetPhysicalDeviceFormatProperties(phys_dev, format, &props);
+			if (props.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) return format;
+		}
+
+		throw std::runtime_error("No supported depth format!");
+	}
+
+	auto max_samples(VkPhysicalDevice phys_dev, VkSampleCountFlagBits max) -> VkSampleCountFlagBits {
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(phys_dev, &props);
+		auto supported = props.limits.framebufferColorSampleCounts & props.limits.framebufferDepthSampleCounts;
+
+		// Sample counts are single bits, so the highest set one wins
+		uint32_t samples = max;
+		while (samples > VK_SAMPLE_COUNT_1_BIT && !(supported & samples)) samples >>= 1;
+
+		return static_cast<VkSampleCountFlagBits>(samples);
+	}
+
 	VkImageView to_view(VkDevice device, VkImage image, VkFormat format,
 			    ImageViewSettings const& settings) {
 		VkImageViewCreateInfo info{};
@@ -32,4 +77,56 @@ namespace ll::image {
 
 		return view;
 	}
+
+	auto create(VkDevice device, VkFormat format, uint32_t width, uint32_t height,
+		    VkImageUsageFlags usage, ImageSettings const& settings) -> VkImage {
+		VkImageCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		info.imageType = VK_IMAGE_TYPE_2D;
+		info.format = format;
+		info.extent.width = width;
+		info.extent.height = height;
+		info.extent.depth = 1;
+		info.mipLevels = settings.mip_levels;
+		info.arrayLayers = 1;
+		info.samples = settings.samples;
+		info.tiling = settings.tiling;
+		info.usage = usage;
+		info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VkImage image{};
+		if (vkCreateImage(device, &info, nullptr, &image) != VK_SUCCESS)
+			throw std::runtime_error("Could not create image!");
+
+		return image;
+	}
+
+	auto transient(VkDevice device, VkFormat format, uint32_t width, uint32_t height,
+		       VkImageUsageFlags attachment_usage, VkSampleCountFlagBits samples) -> VkImage {
+		auto settings = IMAGE_DEFAULTS;
+		settings.samples = samples;
+		return create(device, format, width, height,
+			      attachment_usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, settings);
+	}
+
+	void barrier(VkCommandBuffer cbuf, VkImage image,
+		     VkImageLayout old_layout, VkImageLayout new_layout,
+		     VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+		     VkPipelineStageFlags dst_stage, VkAccessFlags dst_access,
+		     VkImageSubresourceRange const& range)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = src_access;
+		barrier.dstAccessMask = dst_access;
+		barrier.oldLayout = old_layout;
+		barrier.newLayout = new_layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = range;
+
+		vkCmdPipelineBarrier(cbuf, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
 }
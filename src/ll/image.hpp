@@ -19,8 +19,67 @@ namespace ll::image {
 		}
 	};
 
+	struct ImageSettings {
+		VkSampleCountFlagBits samples;
+		VkImageTiling tiling;
+		uint32_t mip_levels;
+	};
+
+	const ImageSettings IMAGE_DEFAULTS {
+		VK_SAMPLE_COUNT_1_BIT,
+		VK_IMAGE_TILING_OPTIMAL,
+		1
+	};
+
+	// Most preferred first, the ones without stencil are cheaper
+	const std::vector<VkFormat> DEPTH_FORMATS = {
+		VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_D24_UNORM_S8_UINT,
+		VK_FORMAT_D32_SFLOAT_S8_UINT,
+		VK_FORMAT_D16_UNORM
+	};
+
+	// Color, depth or depth and stencil, depending on the format
+	auto aspect(VkFormat format) -> VkImageAspectFlags;
+
+	// The first mip level and layer of every aspect of format
+	auto range(VkFormat format) -> VkImageSubresourceRange;
+
+	// The first of candidates that can be a depth attachment with
+	// optimal tiling. Throws if there is none.
+	auto depth_format(VkPhysicalDevice phys_dev, const std::vector<VkFormat>& candidates = DEPTH_FORMATS)
+		-> VkFormat;
+
+	// The highest sample count, up to max, that color and depth
+	// attachments both support
+	auto max_samples(VkPhysicalDevice phys_dev, VkSampleCountFlagBits max = VK_SAMPLE_COUNT_64_BIT)
+		-> VkSampleCountFlagBits;
+
 	auto to_view(VkDevice device, VkImage image, VkFormat format,
 		     ImageViewSettings const& settings = IMAGE_VIEW_DEFAULTS) -> VkImageView;
+
+	// Creates a 2D image in VK_IMAGE_LAYOUT_UNDEFINED, memory has to be
+	// bound separately.
+	auto create(VkDevice device, VkFormat format, uint32_t width, uint32_t height,
+		    VkImageUsageFlags usage, ImageSettings const& settings = IMAGE_DEFAULTS) -> VkImage;
+
+	// An attachment that only lives within a render pass, like a
+	// multisampled color attachment that gets resolved, or depth nobody
+	// reads afterwards. Bind it with VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT
+	// preferred: tilers then keep it in tile memory and never back it.
+	auto transient(VkDevice device, VkFormat format, uint32_t width, uint32_t height,
+		       VkImageUsageFlags attachment_usage, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT)
+		-> VkImage;
+
+	// Records a barrier that moves range from old_layout to new_layout
+	// and makes earlier writes by src_stage visible to dst_access in
+	// dst_stage and later. Old_layout can be VK_IMAGE_LAYOUT_UNDEFINED
+	// if the contents can be thrown away, which is cheaper.
+	void barrier(VkCommandBuffer cbuf, VkImage image,
+		     VkImageLayout old_layout, VkImageLayout new_layout,
+		     VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+		     VkPipelineStageFlags dst_stage, VkAccessFlags dst_access,
+		     VkImageSubresourceRange const& range = IMAGE_VIEW_DEFAULTS.subresource_range);
 }
 
 #endif // Ll_IMAGE_H
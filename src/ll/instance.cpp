@@ -85,7 +85,9 @@ namespace ll::instance {
 		app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		app_info.pEngineName = "Custom Shenanigans";
 		app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		app_info.apiVersion = VK_API_VERSION_1_0;
+		// The highest version we use, devices that only support 1.2 still
+		// work without the 1.3 features
+		app_info.apiVersion = VK_API_VERSION_1_3;
 		instance_info.pApplicationInfo = &app_info;
 
 		VkDebugUtilsMessengerCreateInfoEXT debug_msgr_info{};
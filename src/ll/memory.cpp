@@ -0,0 +1,341 @@
+#include "memory.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <optional>
+#include <set>
+#include <stdexcept>
+
+namespace ll::memory {
+	struct Block {
+		VkDeviceMemory memory;
+		uint32_t type;
+		bool linear;
+		bool dedicated;
+		VkDeviceSize size;
+		void* mapped;
+
+		VkDeviceSize used;
+		uint32_t allocation_ct;
+
+		// free_lists[order] holds the offsets of all free pieces of size
+		// MIN_ALLOCATION << order. Dedicated blocks don't have any.
+		std::vector<std::set<VkDeviceSize>> free_lists;
+	};
+
+	static auto piece_size(uint32_t order) -> VkDeviceSize { return MIN_ALLOCATION << order; }
+
+	// Smallest order whose pieces can hold size bytes
+	static auto order_for(VkDeviceSize size) -> uint32_t {
+		uint32_t order = 0;
+		while (piece_size(order) < size) order++;
+		return order;
+	}
+
+	static auto align_down(VkDeviceSize value, VkDeviceSize alignment) -> VkDeviceSize {
+		return value / alignment * alignment;
+	}
+
+	static auto align_up(VkDeviceSize value, VkDeviceSize alignment) -> VkDeviceSize {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Pieces are aligned to their own size relative to the start of the
+	// block, so splitting always yields correctly aligned offsets as long
+	// as the piece is at least as large as the alignment.
+	static auto buddy_alloc(Block& block, uint32_t order) -> std::optional<VkDeviceSize> {
+		auto found = order;
+		while (found < block.free_lists.size() && block.free_lists[found].empty()) found++;
+		if (found >= block.free_lists.size()) return std::nullopt;
+
+		auto offset = *block.free_lists[found].begin();
+		block.free_lists[found].erase(block.free_lists[found].begin());
+
+		// Split, keeping the lower half and freeing the upper one
+		while (found > order) {
+			found--;
+			block.free_lists[found].insert(offset + piece_size(found));
+		}
+
+		block.used += piece_size(order);
+		block.allocation_ct++;
+
+		return offset;
+	}
+
+	static void buddy_free(Block& block, VkDeviceSize offset, uint32_t order) {
+		block.used -= piece_size(order);
+		block.allocation_ct--;
+
+		// Merge with our buddy for as long as it's free too
+		while (order + 1 < block.free_lists.size()) {
+			auto buddy = offset ^ piece_size(order);
+			auto it = block.free_lists[order].find(buddy);
+			if (it == block.free_lists[order].end()) break;
+
+			block.free_lists[order].erase(it);
+			offset = std::min(offset, buddy);
+			order++;
+		}
+
+		block.free_lists[order].insert(offset);
+	}
+
+	auto find_type(VkPhysicalDevice phys_dev, uint32_t type_bits,
+		       VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) -> uint32_t
+	{
+		VkPhysicalDeviceMemoryProperties props;
+		vkGetPhysicalDeviceMemoryProperties(phys_dev, &props);
+
+		auto wanted = required | preferred;
+		for (uint32_t i = 0; i < props.memoryTypeCount; ++i)
+			if ((type_bits & (1U << i)) && (props.memoryTypes[i].propertyFlags & wanted) == wanted)
+				return i;
+
+		for (uint32_t i = 0; i < props.memoryTypeCount; ++i)
+			if ((type_bits & (1U << i)) && (props.memoryTypes[i].propertyFlags & required) == required)
+				return i;
+
+		throw std::runtime_error("No suitable memory type!");
+	}
+
+	auto allocate(VkDevice device, VkDeviceSize size, uint32_t type) -> VkDeviceMemory {
+		VkMemoryAllocateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		info.allocationSize = size;
+		info.memoryTypeIndex = type;
+
+		VkDeviceMemory memory{};
+		if (vkAllocateMemory(device, &info, nullptr, &memory) != VK_SUCCESS)
+			throw std::runtime_error("Could not allocate memory!");
+
+		return memory;
+	}
+
+	auto map(VkDevice device, VkDeviceMemory memory) -> void* {
+		void* data = nullptr;
+		if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+			throw std::runtime_error("Could not map memory!");
+
+		return data;
+	}
+
+	/*
+	 * Allocator
+	 */
+	Allocator::Allocator(VkPhysicalDevice phys_dev, VkDevice device, VkDeviceSize block_size)
+		: phys_dev(phys_dev), device(device)
+	{
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(phys_dev, &props);
+		vkGetPhysicalDeviceMemoryProperties(phys_dev, &mem_props);
+
+		granularity = props.limits.bufferImageGranularity;
+		atom_size = props.limits.nonCoherentAtomSize;
+		// Pieces are multiples of MIN_ALLOCATION and aligned to it, so
+		// with a smaller granularity two pieces can never share a page
+		separate_linear = granularity > MIN_ALLOCATION;
+
+		pools.resize(mem_props.memoryTypeCount * 2);
+
+		// Don't let a single block take up a big part of a small heap
+		// (like the host-visible part of VRAM some devices expose)
+		for (uint32_t i = 0; i < mem_props.memoryTypeCount; ++i) {
+			auto heap_size = mem_props.memoryHeaps[mem_props.memoryTypes[i].heapIndex].size;
+			auto size = std::max(std::min(block_size, heap_size / 8), MIN_ALLOCATION);
+			block_sizes.push_back(piece_size(order_for(size + 1) - 1));
+		}
+	}
+
+	Allocator::~Allocator() {
+		for (auto& pool : pools) {
+			for (auto& block : pool) {
+				if (block->mapped != nullptr) vkUnmapMemory(device, block->memory);
+				vkFreeMemory(device, block->memory, nullptr);
+			}
+		}
+	}
+
+	auto Allocator::create_block(uint32_t type, bool linear, VkDeviceSize size, bool dedicated) -> Block* {
+		auto block = std::make_unique<Block>();
+		block->memory = ll::memory::allocate(device, size, type);
+		block->type = type;
+		block->linear = linear;
+		block->dedicated = dedicated;
+		block->size = size;
+		block->used = 0;
+		block->allocation_ct = 0;
+
+		block->mapped = nullptr;
+		if (mem_props.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+			block->mapped = ll::memory::map(device, block->memory);
+
+		if (!dedicated) {
+			auto max_order = order_for(size);
+			block->free_lists.resize(max_order + 1);
+			block->free_lists[max_order].insert(0);
+		}
+
+		auto ptr = block.get();
+		pools[type * 2 + (linear ? 1 : 0)].push_back(std::move(block));
+
+		return ptr;
+	}
+
+	void Allocator::destroy_block(Block* block) {
+		if (block->mapped != nullptr) vkUnmapMemory(device, block->memory);
+		vkFreeMemory(device, block->memory, nullptr);
+
+		auto& pool = pools[block->type * 2 + (block->linear ? 1 : 0)];
+		pool.erase(std::find_if(pool.begin(), pool.end(), [&](auto& b){return b.get() == block;}));
+	}
+
+	auto Allocator::allocate(VkMemoryRequirements reqs, bool linear,
+				 VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) -> Allocation {
+		auto type = find_type(phys_dev, reqs.memoryTypeBits, required, preferred);
+		if (!separate_linear) linear = false;
+		auto needed = std::max(reqs.size, reqs.alignment);
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Allocation allocation{};
+		allocation.size = reqs.size;
+		allocation.flags = mem_props.memoryTypes[type].propertyFlags;
+
+		if (needed > block_sizes[type]) {
+			allocation.block = create_block(type, linear, reqs.size, true);
+			allocation.block->used = reqs.size;
+			allocation.block->allocation_ct = 1;
+			allocation.offset = 0;
+		} else {
+			allocation.order = order_for(needed);
+
+			auto& pool = pools[type * 2 + (linear ? 1 : 0)];
+			std::optional<VkDeviceSize> offset;
+			for (auto& block : pool) {
+				if (block->dedicated) continue;
+				offset = buddy_alloc(*block, allocation.order);
+				if (offset.has_value()) {
+					allocation.block = block.get();
+					break;
+				}
+			}
+
+			if (!offset.has_value()) {
+				allocation.block = create_block(type, linear, block_sizes[type], false);
+				offset = buddy_alloc(*allocation.block, allocation.order);
+			}
+
+			allocation.offset = offset.value();
+		}
+
+		allocation.memory = allocation.block->memory;
+		if (allocation.block->mapped != nullptr)
+			allocation.mapped = static_cast<char*>(allocation.block->mapped) + allocation.offset;
+
+		return allocation;
+	}
+
+	void Allocator::free(const Allocation& allocation) {
+		if (allocation.block == nullptr) return;
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto block = allocation.block;
+		if (block->dedicated) {
+			destroy_block(block);
+			return;
+		}
+
+		buddy_free(*block, allocation.offset, allocation.order);
+
+		// Keep one empty block around per pool so allocating and freeing
+		// in a loop doesn't hit vkAllocateMemory every time
+		if (block->allocation_ct == 0) {
+			auto& pool = pools[block->type * 2 + (block->linear ? 1 : 0)];
+			auto empty_ct = std::count_if(pool.begin(), pool.end(), [](auto& b) {
+				return !b->dedicated && b->allocation_ct == 0;
+			});
+			if (empty_ct > 1) destroy_block(block);
+		}
+	}
+
+	auto Allocator::bind(VkBuffer buffer,
+			     VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) -> Allocation {
+		VkMemoryRequirements reqs;
+		vkGetBufferMemoryRequirements(device, buffer, &reqs);
+
+		auto allocation = allocate(reqs, true, required, preferred);
+		if (vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS)
+			throw std::runtime_error("Could not bind buffer memory!");
+
+		return allocation;
+	}
+
+	auto Allocator::bind(VkImage image, bool linear,
+			     VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) -> Allocation {
+		VkMemoryRequirements reqs;
+		vkGetImageMemoryRequirements(device, image, &reqs);
+
+		auto allocation = allocate(reqs, linear, required, preferred);
+		if (vkBindImageMemory(device, image, allocation.memory, allocation.offset) != VK_SUCCESS)
+			throw std::runtime_error("Could not bind image memory!");
+
+		return allocation;
+	}
+
+	auto Allocator::mapped_range(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const
+		-> VkMappedMemoryRange
+	{
+		if (size == VK_WHOLE_SIZE) size = allocation.size - offset;
+		auto begin = allocation.offset + offset;
+
+		VkMappedMemoryRange range{};
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory = allocation.memory;
+		range.offset = align_down(begin, atom_size);
+		range.size = std::min(align_up(begin + size, atom_size), allocation.block->size) - range.offset;
+
+		return range;
+	}
+
+	void Allocator::flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const {
+		if (allocation.flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) return;
+
+		auto range = mapped_range(allocation, offset, size);
+		if (vkFlushMappedMemoryRanges(device, 1, &range) != VK_SUCCESS)
+			throw std::runtime_error("Could not flush mapped memory!");
+	}
+
+	void Allocator::invalidate(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const {
+		if (allocation.flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) return;
+
+		auto range = mapped_range(allocation, offset, size);
+		if (vkInvalidateMappedMemoryRanges(device, 1, &range) != VK_SUCCESS)
+			throw std::runtime_error("Could not invalidate mapped memory!");
+	}
+
+	auto Allocator::stats() const -> std::vector<BlockStats> {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::vector<BlockStats> out;
+		for (auto const& pool : pools)
+			for (auto const& block : pool)
+				out.push_back({block->type, block->linear, block->dedicated,
+					       block->size, block->used, block->allocation_ct});
+
+		return out;
+	}
+
+	void Allocator::print_stats(std::ostream& out) const {
+		const double MIB = 1024.0 * 1024.0;
+
+		for (auto const& s : stats()) {
+			out << "Memory type " << s.memory_type
+			    << (s.dedicated ? " dedicated" : (s.linear ? " linear" : ""))
+			    << " block: " << std::fixed << std::setprecision(2)
+			    << s.used / MIB << " / " << s.size / MIB << " MiB used ("
+			    << s.allocation_ct << " allocations)" << std::endl;
+		}
+	}
+}
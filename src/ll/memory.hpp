@@ -0,0 +1,115 @@
+#ifndef LL_MEMORY_H
+#define LL_MEMORY_H
+
+#include <vulkan/vulkan.h>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace ll::memory {
+	// Returns the index of a memory type allowed by type_bits (usually
+	// VkMemoryRequirements::memoryTypeBits) that has all the required
+	// properties. If possible, one that also has the preferred properties
+	// is chosen.
+	auto find_type(VkPhysicalDevice phys_dev, uint32_t type_bits,
+		       VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) -> uint32_t;
+
+	auto allocate(VkDevice device, VkDeviceSize size, uint32_t type) -> VkDeviceMemory;
+
+	// Maps the whole allocation
+	auto map(VkDevice device, VkDeviceMemory memory) -> void*;
+
+	// Blocks are split into power-of-two sized pieces, this is the
+	// smallest one.
+	const VkDeviceSize MIN_ALLOCATION = 256;
+	const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ULL * 1024 * 1024;
+
+	struct Block;
+
+	struct Allocation {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		// What was asked for, the allocator may have reserved more
+		VkDeviceSize size = 0;
+		VkMemoryPropertyFlags flags = 0;
+		// Only set for host-visible memory, blocks stay mapped for their
+		// whole life
+		void* mapped = nullptr;
+
+		// Owned by the allocator
+		Block* block = nullptr;
+		uint32_t order = 0;
+	};
+
+	struct BlockStats {
+		uint32_t memory_type;
+		// Whether the block holds linear resources (buffers and linear
+		// images), only meaningful if the device needs them separated
+		bool linear;
+		bool dedicated;
+		VkDeviceSize size;
+		VkDeviceSize used;
+		uint32_t allocation_ct;
+	};
+
+	// Keeps a list of large blocks for every memory type and hands out
+	// pieces of them with a buddy allocator. Allocations larger than a
+	// block get a dedicated VkDeviceMemory.
+	//
+	// If the device's bufferImageGranularity is larger than
+	// MIN_ALLOCATION, linear and optimal-tiling resources are kept in
+	// separate blocks so they can never share a granularity page.
+	//
+	// Thread-safe.
+	struct Allocator {
+		Allocator(VkPhysicalDevice phys_dev, VkDevice device,
+			  VkDeviceSize block_size = DEFAULT_BLOCK_SIZE);
+		~Allocator();
+
+		Allocator(const Allocator&) = delete;
+		auto operator=(const Allocator&) -> Allocator& = delete;
+
+		auto allocate(VkMemoryRequirements reqs, bool linear,
+			      VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) -> Allocation;
+
+		void free(const Allocation& allocation);
+
+		// Allocate memory for a resource and bind it
+		auto bind(VkBuffer buffer,
+			  VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) -> Allocation;
+		auto bind(VkImage image, bool linear,
+			  VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) -> Allocation;
+
+		// No-ops for coherent memory. The range is expanded to
+		// nonCoherentAtomSize as needed.
+		void flush(const Allocation& allocation, VkDeviceSize offset = 0,
+			   VkDeviceSize size = VK_WHOLE_SIZE) const;
+		void invalidate(const Allocation& allocation, VkDeviceSize offset = 0,
+				VkDeviceSize size = VK_WHOLE_SIZE) const;
+
+		auto stats() const -> std::vector<BlockStats>;
+		void print_stats(std::ostream& out) const;
+
+	private:
+		VkPhysicalDevice phys_dev;
+		VkDevice device;
+		VkPhysicalDeviceMemoryProperties mem_props{};
+		VkDeviceSize granularity;
+		VkDeviceSize atom_size;
+		bool separate_linear;
+
+		// Index is memory_type * 2 + linear
+		std::vector<std::vector<std::unique_ptr<Block>>> pools;
+		// Block size for each memory type, smaller for small heaps
+		std::vector<VkDeviceSize> block_sizes;
+		mutable std::mutex mutex;
+
+		auto create_block(uint32_t type, bool linear, VkDeviceSize size, bool dedicated) -> Block*;
+		void destroy_block(Block* block);
+		auto mapped_range(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const
+			-> VkMappedMemoryRange;
+	};
+}
+
+#endif // LL_MEMORY_H
@@ -38,9 +38,28 @@ namespace ll::phys_dev {
 	
 	auto default_scorer(VkPhysicalDevice const&,
 			    VkPhysicalDeviceProperties const& props, VkPhysicalDeviceFeatures const&) -> int {
+		// Timeline semaphores are core in 1.2
+		if (props.apiVersion < VK_API_VERSION_1_2) return 0;
+
 		auto score = 1;
 		if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) score += 1;
 		
 		return score;
 	}
+
+	auto dynamic_rendering(VkPhysicalDevice phys_dev) -> bool {
+		// Chaining 1.3 features is only allowed on 1.3 devices
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(phys_dev, &props);
+		if (props.apiVersion < VK_API_VERSION_1_3) return false;
+
+		VkPhysicalDeviceVulkan13Features supported13{};
+		supported13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+		VkPhysicalDeviceFeatures2 supported{};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &supported13;
+		vkGetPhysicalDeviceFeatures2(phys_dev, &supported);
+
+		return supported13.dynamicRendering;
+	}
 }
@@ -13,6 +13,10 @@ namespace ll::phys_dev {
 
 	auto default_scorer(VkPhysicalDevice const& phys_dev,
 			    VkPhysicalDeviceProperties const& props, VkPhysicalDeviceFeatures const&) -> int;
+
+	// Whether the device supports Vulkan 1.3's dynamic rendering, which
+	// base::Default enables whenever it can
+	auto dynamic_rendering(VkPhysicalDevice phys_dev) -> bool;
 }
 
 #endif // LL_PHYS_DEV_H
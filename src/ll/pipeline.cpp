@@ -2,11 +2,166 @@
 
 #include <stdexcept>
 #include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
 
 namespace ll::pipeline {
-	auto layout(VkDevice device) -> VkPipelineLayout {
+	// Put in front of the driver's data. The driver's own header already
+	// has the UUID, vendor and device, but not the driver version, and we
+	// don't want to trust the driver to validate what we feed it.
+	struct CacheFileHeader {
+		uint32_t magic;
+		uint32_t vendor_id;
+		uint32_t device_id;
+		uint32_t driver_version;
+		uint8_t uuid[VK_UUID_SIZE];
+		uint64_t data_size;
+	};
+
+	const uint32_t CACHE_FILE_MAGIC = 0x43505243; // "CRPC"
+
+	static auto cache_file_header(VkPhysicalDevice phys_dev) -> CacheFileHeader {
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(phys_dev, &props);
+
+		CacheFileHeader header{};
+		header.magic = CACHE_FILE_MAGIC;
+		header.vendor_id = props.vendorID;
+		header.device_id = props.deviceID;
+		header.driver_version = props.driverVersion;
+		std::memcpy(header.uuid, props.pipelineCacheUUID, VK_UUID_SIZE);
+
+		return header;
+	}
+
+	// Reads filename and returns the cache data in it, or nothing if it
+	// doesn't belong to this device.
+	static auto read_cache_file(VkPhysicalDevice phys_dev, const std::string& filename) -> std::vector<char> {
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open()) return {};
+
+		auto expected = cache_file_header(phys_dev);
+		CacheFileHeader header{};
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return {};
+
+		if (header.magic != expected.magic
+		    || header.vendor_id != expected.vendor_id
+		    || header.device_id != expected.device_id
+		    || header.driver_version != expected.driver_version
+		    || std::memcmp(header.uuid, expected.uuid, VK_UUID_SIZE) != 0)
+			return {};
+
+		// A corrupt size could ask for more memory than there is, so
+		// check it against what's actually left in the file first
+		auto data_start = file.tellg();
+		file.seekg(0, std::ios::end);
+		auto file_end = file.tellg();
+		if (data_start < 0 || file_end < data_start
+		    || header.data_size > static_cast<uint64_t>(file_end - data_start))
+			return {};
+		file.seekg(data_start);
+
+		std::vector<char> data(header.data_size);
+		if (!file.read(data.data(), data.size())) return {};
+
+		// The Vulkan header: length, version, vendor ID, device ID, UUID
+		const size_t VK_HEADER_SIZE = 16 + VK_UUID_SIZE;
+		if (data.size() < VK_HEADER_SIZE) return {};
+
+		std::array<uint32_t, 4> vk_header{};
+		std::memcpy(vk_header.data(), data.data(), sizeof(vk_header));
+		if (vk_header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		    || vk_header[2] != expected.vendor_id
+		    || vk_header[3] != expected.device_id
+		    || std::memcmp(data.data() + 16, expected.uuid, VK_UUID_SIZE) != 0)
+			return {};
+
+		return data;
+	}
+
+	auto load_cache(VkPhysicalDevice phys_dev, VkDevice device, const std::string& filename)
+		-> VkPipelineCache
+	{
+		auto data = read_cache_file(phys_dev, filename);
+
+		VkPipelineCacheCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		info.initialDataSize = data.size();
+		info.pInitialData = data.empty() ? nullptr : data.data();
+
+		VkPipelineCache cache{};
+		if (vkCreatePipelineCache(device, &info, nullptr, &cache) != VK_SUCCESS)
+			throw std::runtime_error("Could not create pipeline cache!");
+
+		return cache;
+	}
+
+	void save_cache(VkPhysicalDevice phys_dev, VkDevice device, VkPipelineCache cache,
+			const std::string& filename)
+	{
+		size_t size = 0;
+		if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS)
+			throw std::runtime_error("Could not get pipeline cache size!");
+
+		std::vector<char> data(size);
+		if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS)
+			throw std::runtime_error("Could not get pipeline cache data!");
+		data.resize(size);
+
+		auto header = cache_file_header(phys_dev);
+		header.data_size = data.size();
+
+		// Write to a temporary file first so a crash halfway through
+		// can't leave a truncated cache behind
+		auto tmp_filename = filename + ".tmp";
+		{
+			std::ofstream file(tmp_filename, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				throw std::runtime_error("Could not open " + tmp_filename + "!");
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(data.data(), data.size());
+			if (!file) throw std::runtime_error("Could not write " + tmp_filename + "!");
+		}
+
+		if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0)
+			throw std::runtime_error("Could not replace " + filename + "!");
+	}
+
+	auto vertex_binding(uint32_t binding, uint32_t stride, VkVertexInputRate rate)
+		-> VkVertexInputBindingDescription
+	{
+		VkVertexInputBindingDescription desc{};
+		desc.binding = binding;
+		desc.stride = stride;
+		desc.inputRate = rate;
+
+		return desc;
+	}
+
+	auto vertex_attribute(uint32_t location, uint32_t binding, VkFormat format, uint32_t offset)
+		-> VkVertexInputAttributeDescription
+	{
+		VkVertexInputAttributeDescription desc{};
+		desc.location = location;
+		desc.binding = binding;
+		desc.format = format;
+		desc.offset = offset;
+
+		return desc;
+	}
+
+	auto layout(VkDevice device, const std::vector<VkDescriptorSetLayout>& set_layouts,
+		    const std::vector<VkPushConstantRange>& push_ranges)
+		-> VkPipelineLayout
+	{
 		VkPipelineLayoutCreateInfo layout_info{};
 		layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layout_info.setLayoutCount = set_layouts.size();
+		layout_info.pSetLayouts = set_layouts.data();
+		layout_info.pushConstantRangeCount = push_ranges.size();
+		layout_info.pPushConstantRanges = push_ranges.data();
 
 		VkPipelineLayout layout{};
 		if (vkCreatePipelineLayout(device, &layout_info, nullptr, &layout) != VK_SUCCESS)
@@ -15,17 +170,63 @@ namespace ll::pipeline {
 		return layout;
 	}
 
-	auto pipeline(VkDevice device,
-		      uint32_t shader_ct, VkPipelineShaderStageCreateInfo* shaders,
-		      VkPipelineLayout layout, VkRenderPass rpass)
+	/*
+	 * LayoutCache
+	 */
+	LayoutCache::LayoutCache(VkDevice device) : device(device) {}
+
+	LayoutCache::~LayoutCache() {
+		for (auto& [key, layout] : layouts) vkDestroyPipelineLayout(device, layout, nullptr);
+	}
+
+	auto LayoutCache::get(const std::vector<VkDescriptorSetLayout>& set_layouts,
+			      const std::vector<VkPushConstantRange>& push_ranges) -> VkPipelineLayout
+	{
+		Key key;
+		key.first = set_layouts;
+		for (const auto& r : push_ranges) key.second.emplace_back(r.stageFlags, r.offset, r.size);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto existing = layouts.find(key);
+		if (existing != layouts.end()) return existing->second;
+
+		auto created = layout(device, set_layouts, push_ranges);
+		layouts.emplace(std::move(key), created);
+
+		return created;
+	}
+
+	auto LayoutCache::get(descriptor::LayoutCache& set_layouts, const std::vector<shader::Reflection>& shaders)
+		-> VkPipelineLayout
+	{
+		std::vector<VkDescriptorSetLayout> sets;
+		for (auto& bindings : shader::set_bindings(shaders)) sets.push_back(set_layouts.get(bindings));
+
+		return get(sets, shader::push_ranges(shaders));
+	}
+
+	auto LayoutCache::size() const -> size_t {
+		std::lock_guard<std::mutex> lock(mutex);
+		return layouts.size();
+	}
+
+	// Formats is only used (and has to be set) if rpass is VK_NULL_HANDLE
+	static auto graphics(VkDevice device,
+			     uint32_t shader_ct, VkPipelineShaderStageCreateInfo* shaders,
+			     VkPipelineLayout layout, VkRenderPass rpass, const RenderingFormats* formats,
+			     VkPipelineCache cache, const PipelineSettings& settings)
 		-> VkPipeline
 	{
 		VkPipelineVertexInputStateCreateInfo vertex_input{};
 		vertex_input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertex_input.vertexBindingDescriptionCount = settings.vertex_bindings.size();
+		vertex_input.pVertexBindingDescriptions = settings.vertex_bindings.data();
+		vertex_input.vertexAttributeDescriptionCount = settings.vertex_attributes.size();
+		vertex_input.pVertexAttributeDescriptions = settings.vertex_attributes.data();
 
 		VkPipelineInputAssemblyStateCreateInfo input_assembly{};
 		input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		input_assembly.topology = settings.topology;
 		input_assembly.primitiveRestartEnable = VK_FALSE;
 
 		VkPipelineViewportStateCreateInfo viewport{};
@@ -40,14 +241,22 @@ namespace ll::pipeline {
 		rasterizer.rasterizerDiscardEnable = VK_FALSE;
 		rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
 		rasterizer.lineWidth = 1.0F;
-		rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-		rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+		rasterizer.cullMode = settings.cull_mode;
+		rasterizer.frontFace = settings.front_face;
 		rasterizer.depthBiasEnable = VK_FALSE;
 
 		VkPipelineMultisampleStateCreateInfo multisampling{};
 		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 		multisampling.sampleShadingEnable = VK_FALSE;
-		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		multisampling.rasterizationSamples = settings.samples;
+
+		VkPipelineDepthStencilStateCreateInfo depth_stencil{};
+		depth_stencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depth_stencil.depthTestEnable = settings.depth_test ? VK_TRUE : VK_FALSE;
+		depth_stencil.depthWriteEnable = settings.depth_write ? VK_TRUE : VK_FALSE;
+		depth_stencil.depthCompareOp = settings.depth_compare;
+		depth_stencil.depthBoundsTestEnable = VK_FALSE;
+		depth_stencil.stencilTestEnable = VK_FALSE;
 
 		VkPipelineColorBlendAttachmentState attachment_blend{};
 		attachment_blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT
@@ -56,11 +265,14 @@ namespace ll::pipeline {
 			| VK_COLOR_COMPONENT_A_BIT;
 		attachment_blend.blendEnable = VK_FALSE;
 
+		std::vector<VkPipelineColorBlendAttachmentState> attachment_blends(
+			rpass == VK_NULL_HANDLE ? formats->colors.size() : settings.color_ct, attachment_blend);
+
 		VkPipelineColorBlendStateCreateInfo blending{};
 		blending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 		blending.logicOpEnable = VK_FALSE;
-		blending.attachmentCount = 1;
-		blending.pAttachments = &attachment_blend;
+		blending.attachmentCount = attachment_blends.size();
+		blending.pAttachments = attachment_blends.data();
 
 		std::array<VkDynamicState, 2> dyn_states = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
 
@@ -78,16 +290,74 @@ namespace ll::pipeline {
 		pipeline_info.pViewportState = &viewport;
 		pipeline_info.pRasterizationState = &rasterizer;
 		pipeline_info.pMultisampleState = &multisampling;
+		pipeline_info.pDepthStencilState = &depth_stencil;
 		pipeline_info.pColorBlendState = &blending;
 		pipeline_info.pDynamicState = &dyn_state;
 		pipeline_info.layout = layout;
 		pipeline_info.renderPass = rpass;
 		pipeline_info.subpass = 0;
 
+		VkPipelineRenderingCreateInfo rendering_info{};
+		rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+		if (rpass == VK_NULL_HANDLE) {
+			rendering_info.colorAttachmentCount = formats->colors.size();
+			rendering_info.pColorAttachmentFormats = formats->colors.data();
+			rendering_info.depthAttachmentFormat = formats->depth;
+			rendering_info.stencilAttachmentFormat = formats->stencil;
+			pipeline_info.pNext = &rendering_info;
+		}
+
 		VkPipeline pipeline{};
-		if (vkCreateGraphicsPipelines(device, nullptr, 1, &pipeline_info, nullptr, &pipeline) != VK_SUCCESS)
+		if (vkCreateGraphicsPipelines(device, cache, 1, &pipeline_info, nullptr, &pipeline) != VK_SUCCESS)
 			throw std::runtime_error("Could not create pipeline!");
 
 		return pipeline;
 	}
+
+	auto pipeline(VkDevice device,
+		      uint32_t shader_ct, VkPipelineShaderStageCreateInfo* shaders,
+		      VkPipelineLayout layout, VkRenderPass rpass,
+		      VkPipelineCache cache, const PipelineSettings& settings)
+		-> VkPipeline
+	{
+		if (rpass == VK_NULL_HANDLE)
+			throw std::runtime_error("Pipelines without a render pass need attachment formats!");
+
+		return graphics(device, shader_ct, shaders, layout, rpass, nullptr, cache, settings);
+	}
+
+	auto pipeline(VkDevice device,
+		      uint32_t shader_ct, VkPipelineShaderStageCreateInfo* shaders,
+		      VkPipelineLayout layout, const RenderingFormats& formats,
+		      VkPipelineCache cache, const PipelineSettings& settings)
+		-> VkPipeline
+	{
+		return graphics(device, shader_ct, shaders, layout, VK_NULL_HANDLE, &formats, cache, settings);
+	}
+
+	auto pipeline(VkDevice device, const PipelineDesc& desc, VkPipelineCache cache) -> VkPipeline {
+		// vkCreateGraphicsPipelines doesn't write to the stages
+		auto shaders = const_cast<VkPipelineShaderStageCreateInfo*>(desc.shaders.data());
+		return graphics(device, desc.shaders.size(), shaders, desc.layout, desc.rpass,
+				&desc.formats, cache, desc.settings);
+	}
+
+	auto compute(VkDevice device, const VkPipelineShaderStageCreateInfo& shader,
+		     VkPipelineLayout layout, VkPipelineCache cache)
+		-> VkPipeline
+	{
+		if (shader.stage != VK_SHADER_STAGE_COMPUTE_BIT)
+			throw std::runtime_error("Compute pipelines need a compute shader!");
+
+		VkComputePipelineCreateInfo pipeline_info{};
+		pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeline_info.stage = shader;
+		pipeline_info.layout = layout;
+
+		VkPipeline pipeline{};
+		if (vkCreateComputePipelines(device, cache, 1, &pipeline_info, nullptr, &pipeline) != VK_SUCCESS)
+			throw std::runtime_error("Could not create compute pipeline!");
+
+		return pipeline;
+	}
 }
@@ -1,15 +1,160 @@
 #ifndef LL_PIPELINE_H
 #define LL_PIPELINE_H
 
+#include "descriptor.hpp"
+#include "shader.hpp"
+
 #include <vulkan/vulkan.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
 
 namespace ll::pipeline {
-	auto layout(VkDevice device) -> VkPipelineLayout;
+	struct PipelineSettings {
+		// Both empty means no vertex buffers, the vertex shader has
+		// to make up its own positions
+		std::vector<VkVertexInputBindingDescription> vertex_bindings;
+		std::vector<VkVertexInputAttributeDescription> vertex_attributes;
+		VkPrimitiveTopology topology;
+		VkCullModeFlags cull_mode;
+		VkFrontFace front_face;
+		// Has to match the render pass's attachments
+		VkSampleCountFlagBits samples;
+		// Only do anything if the subpass has a depth attachment
+		bool depth_test;
+		bool depth_write;
+		VkCompareOp depth_compare;
+		// Color attachments of the subpass, each gets the same blend
+		// state. Ignored with dynamic rendering, where it's the number
+		// of color formats.
+		uint32_t color_ct;
+	};
+
+	const PipelineSettings PIPELINE_DEFAULTS {
+		{}, // vertex_bindings
+		{}, // vertex_attributes
+		VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+		VK_CULL_MODE_BACK_BIT,
+		VK_FRONT_FACE_CLOCKWISE,
+		VK_SAMPLE_COUNT_1_BIT,
+		false, // depth_test
+		false, // depth_write
+		VK_COMPARE_OP_LESS,
+		1 // color_ct
+	};
+
+	auto vertex_binding(uint32_t binding, uint32_t stride,
+			    VkVertexInputRate rate = VK_VERTEX_INPUT_RATE_VERTEX)
+		-> VkVertexInputBindingDescription;
+
+	auto vertex_attribute(uint32_t location, uint32_t binding, VkFormat format, uint32_t offset)
+		-> VkVertexInputAttributeDescription;
+
+	// What a pipeline draws into with dynamic rendering, instead of a
+	// render pass. Depth and stencil are VK_FORMAT_UNDEFINED if there
+	// is none.
+	struct RenderingFormats {
+		std::vector<VkFormat> colors;
+		VkFormat depth = VK_FORMAT_UNDEFINED;
+		VkFormat stencil = VK_FORMAT_UNDEFINED;
+	};
+
+	// Everything pipeline() needs, so a pipeline can be described now and
+	// created later (possibly on another thread). The shader stages' pName
+	// and pSpecializationInfo must outlive the pipeline's creation.
+	struct PipelineDesc {
+		std::vector<VkPipelineShaderStageCreateInfo> shaders;
+		VkPipelineLayout layout;
+		VkRenderPass rpass;
+		PipelineSettings settings = PIPELINE_DEFAULTS;
+		// Only used if rpass is VK_NULL_HANDLE
+		RenderingFormats formats = {};
+	};
+
+	// Push constant ranges of different stages may not overlap, and
+	// together they have to fit in maxPushConstantsSize (at least 128
+	// bytes)
+	auto layout(VkDevice device, const std::vector<VkDescriptorSetLayout>& set_layouts = {},
+		    const std::vector<VkPushConstantRange>& push_ranges = {})
+		-> VkPipelineLayout;
+
+	// Hands out one VkPipelineLayout per distinct combination of set
+	// layouts and push constant ranges, like descriptor::LayoutCache.
+	// Layouts live as long as the cache.
+	//
+	// Thread-safe, so pipelines can be described on several threads.
+	struct LayoutCache {
+		explicit LayoutCache(VkDevice device);
+		~LayoutCache();
+
+		LayoutCache(const LayoutCache&) = delete;
+		auto operator=(const LayoutCache&) -> LayoutCache& = delete;
+
+		auto get(const std::vector<VkDescriptorSetLayout>& set_layouts,
+			 const std::vector<VkPushConstantRange>& push_ranges = {}) -> VkPipelineLayout;
+
+		// Generated from the reflection of a pipeline's shaders, see
+		// shader::set_bindings() and shader::push_ranges(). The set
+		// layouts come from set_layouts, so pipelines with the same
+		// interface share them as well.
+		auto get(descriptor::LayoutCache& set_layouts, const std::vector<shader::Reflection>& shaders)
+			-> VkPipelineLayout;
+
+		auto size() const -> size_t;
 
+	private:
+		// The set layouts, then (stages, offset, size) of each range
+		using Key = std::pair<std::vector<VkDescriptorSetLayout>,
+				      std::vector<std::tuple<VkShaderStageFlags, uint32_t, uint32_t>>>;
+
+		VkDevice device;
+		std::map<Key, VkPipelineLayout> layouts;
+		mutable std::mutex mutex;
+	};
+
+	auto pipeline(VkDevice device,
+		      uint32_t shader_ct, VkPipelineShaderStageCreateInfo* shaders,
+		      VkPipelineLayout layout, VkRenderPass rpass,
+		      VkPipelineCache cache = VK_NULL_HANDLE,
+		      const PipelineSettings& settings = PIPELINE_DEFAULTS)
+		-> VkPipeline;
+
+	// For dynamic rendering: built against attachment formats instead of
+	// a render pass, so it can be used in any vkCmdBeginRendering() with
+	// the same formats and sample count. Needs the dynamicRendering
+	// feature.
 	auto pipeline(VkDevice device,
 		      uint32_t shader_ct, VkPipelineShaderStageCreateInfo* shaders,
-		      VkPipelineLayout layout, VkRenderPass rpass)
+		      VkPipelineLayout layout, const RenderingFormats& formats,
+		      VkPipelineCache cache = VK_NULL_HANDLE,
+		      const PipelineSettings& settings = PIPELINE_DEFAULTS)
 		-> VkPipeline;
+
+	auto pipeline(VkDevice device, const PipelineDesc& desc, VkPipelineCache cache = VK_NULL_HANDLE)
+		-> VkPipeline;
+
+	// Shader has to be a VK_SHADER_STAGE_COMPUTE_BIT stage. Bind the
+	// result with VK_PIPELINE_BIND_POINT_COMPUTE.
+	auto compute(VkDevice device, const VkPipelineShaderStageCreateInfo& shader,
+		     VkPipelineLayout layout, VkPipelineCache cache = VK_NULL_HANDLE)
+		-> VkPipeline;
+
+	// Creates a pipeline cache, filled with whatever save_cache() wrote to
+	// filename earlier. If the file is missing, corrupt, or was written by
+	// a different device or driver version (going by vendor/device ID,
+	// pipelineCacheUUID and driverVersion), the cache starts out empty.
+	//
+	// The cache is internally synchronized, so it can be shared by
+	// pipelines being created on several threads at once.
+	auto load_cache(VkPhysicalDevice phys_dev, VkDevice device, const std::string& filename)
+		-> VkPipelineCache;
+
+	// Writes the cache's contents to filename, tagged with the device's
+	// identity so load_cache() can reject it on other setups.
+	void save_cache(VkPhysicalDevice phys_dev, VkDevice device, VkPipelineCache cache,
+			const std::string& filename);
 }
 
 #endif // LL_PIPELINE_H
@@ -0,0 +1,151 @@
+#include "query.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+namespace ll::query {
+	auto pool(VkDevice device, VkQueryType type, uint32_t query_ct) -> VkQueryPool {
+		VkQueryPoolCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		info.queryType = type;
+		info.queryCount = query_ct;
+
+		VkQueryPool pool{};
+		if (vkCreateQueryPool(device, &info, nullptr, &pool) != VK_SUCCESS)
+			throw std::runtime_error("Could not create query pool!");
+
+		return pool;
+	}
+
+	Profiler::Profiler(VkPhysicalDevice phys_dev, VkDevice device, uint32_t queue_fam,
+			   uint32_t frame_ct, uint32_t max_scopes)
+		: device(device), max_scopes(max_scopes)
+	{
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(phys_dev, &props);
+		period = props.limits.timestampPeriod;
+
+		uint32_t fam_ct = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(phys_dev, &fam_ct, nullptr);
+		std::vector<VkQueueFamilyProperties> fam_props(fam_ct);
+		vkGetPhysicalDeviceQueueFamilyProperties(phys_dev, &fam_ct, fam_props.data());
+		if (queue_fam >= fam_ct) throw std::runtime_error("Queue family out of range!");
+
+		auto valid_bits = fam_props[queue_fam].timestampValidBits;
+		mask = valid_bits >= 64 ? UINT64_MAX : (1ULL << valid_bits) - 1;
+		if (valid_bits == 0) return;
+
+		for (uint32_t i = 0; i < frame_ct; ++i)
+			frames.push_back({ll::query::pool(device, VK_QUERY_TYPE_TIMESTAMP, max_scopes * 2), {}});
+	}
+
+	Profiler::~Profiler() {
+		for (auto& frame : frames) vkDestroyQueryPool(device, frame.pool, nullptr);
+	}
+
+	auto Profiler::supported() const -> bool {
+		return !frames.empty();
+	}
+
+	void Profiler::collect(FrameQueries& frame) {
+		if (frame.scopes.empty()) return;
+
+		// Pairs of (timestamp, availability)
+		std::vector<uint64_t> results(frame.scopes.size() * 4);
+		// NOT_READY just means some aren't available, which we check
+		// per query anyway
+		auto res = vkGetQueryPoolResults(device, frame.pool, 0, frame.scopes.size() * 2,
+						 results.size() * sizeof(uint64_t), results.data(), sizeof(uint64_t) * 2,
+						 VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if (res != VK_SUCCESS && res != VK_NOT_READY)
+			throw std::runtime_error("Could not get query results!");
+
+		for (const auto& scope : frame.scopes) {
+			auto begin = &results[static_cast<size_t>(scope.first_query) * 2];
+			auto end = begin + 2;
+			if (begin[1] == 0 || end[1] == 0) continue;
+
+			// Masking handles the counter wrapping around
+			auto ticks = (end[0] - begin[0]) & mask;
+			auto& s = samples[scope.name_idx];
+			s.ring[s.next % SAMPLE_CT] = static_cast<double>(ticks) * period / 1e6;
+			s.next++;
+		}
+
+		frame.scopes.clear();
+	}
+
+	void Profiler::begin_frame(VkCommandBuffer cbuf, uint32_t idx) {
+		if (!supported()) return;
+		if (idx >= frames.size()) throw std::runtime_error("Frame index out of range!");
+		frame_idx = idx;
+
+		auto& frame = frames[frame_idx];
+		collect(frame);
+		vkCmdResetQueryPool(cbuf, frame.pool, 0, max_scopes * 2);
+	}
+
+	auto Profiler::begin(VkCommandBuffer cbuf, const std::string& name) -> uint32_t {
+		if (!supported()) return NO_SCOPE;
+
+		auto& frame = frames[frame_idx];
+		if (frame.scopes.size() >= max_scopes) return NO_SCOPE;
+
+		auto it = name_indices.find(name);
+		if (it == name_indices.end()) {
+			it = name_indices.emplace(name, samples.size()).first;
+			samples.push_back({name, std::vector<double>(SAMPLE_CT), 0});
+		}
+
+		uint32_t scope = frame.scopes.size();
+		frame.scopes.push_back({it->second, scope * 2});
+		vkCmdWriteTimestamp(cbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, scope * 2);
+
+		return scope;
+	}
+
+	void Profiler::end(VkCommandBuffer cbuf, uint32_t scope) {
+		if (scope == NO_SCOPE) return;
+		vkCmdWriteTimestamp(cbuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frames[frame_idx].pool, scope * 2 + 1);
+	}
+
+	auto Profiler::stats() const -> std::vector<ScopeStats> {
+		std::vector<ScopeStats> all;
+
+		for (const auto& s : samples) {
+			auto ct = std::min(s.next, SAMPLE_CT);
+			if (ct == 0) continue;
+
+			std::vector<double> sorted(s.ring.begin(), s.ring.begin() + ct);
+			std::sort(sorted.begin(), sorted.end());
+
+			double sum = 0.0;
+			for (auto sample : sorted) sum += sample;
+
+			auto p99_idx = std::min<size_t>(ct - 1, static_cast<size_t>(ct * 0.99));
+			all.push_back({s.name, sorted.front(), sum / ct, sorted[p99_idx], ct});
+		}
+
+		std::sort(all.begin(), all.end(), [](const ScopeStats& a, const ScopeStats& b) {
+			return a.name < b.name;
+		});
+
+		return all;
+	}
+
+	void Profiler::print_stats(std::ostream& out) const {
+		if (!supported()) {
+			out << "GPU timestamps not supported on this queue" << std::endl;
+			return;
+		}
+
+		out << "GPU time (ms)     min       avg       p99   samples" << std::endl;
+		for (const auto& s : stats()) {
+			out << std::left << std::setw(14) << s.name << std::right << std::fixed << std::setprecision(3)
+			    << std::setw(8) << s.min << std::setw(10) << s.avg << std::setw(10) << s.p99
+			    << std::setw(10) << s.sample_ct << std::endl;
+		}
+		out << std::defaultfloat;
+	}
+}
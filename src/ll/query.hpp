@@ -0,0 +1,98 @@
+#ifndef LL_QUERY_H
+#define LL_QUERY_H
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ll::query {
+	auto pool(VkDevice device, VkQueryType type, uint32_t query_ct) -> VkQueryPool;
+
+	const uint32_t DEFAULT_MAX_SCOPES = 64;
+	// How many of the most recent samples are kept for each scope
+	const uint32_t SAMPLE_CT = 1024;
+	// Returned by begin() when a frame has run out of scopes
+	const uint32_t NO_SCOPE = UINT32_MAX;
+
+	// In milliseconds
+	struct ScopeStats {
+		std::string name;
+		double min;
+		double avg;
+		double p99;
+		uint32_t sample_ct;
+	};
+
+	// Measures named scopes of command buffers with pairs of timestamps.
+	//
+	// Every frame in flight has its own query pool, and a frame's results
+	// are read when its slot comes around again (so frame_ct frames
+	// late). By then the frame's fence has signalled, so reading never
+	// stalls. Results that still aren't available are dropped.
+	//
+	// Scopes are written to the primary command buffer, and can be nested.
+	// Not thread-safe.
+	struct Profiler {
+		// Queue_fam is the family the command buffers are submitted to.
+		// If it doesn't support timestamps, the profiler does nothing.
+		Profiler(VkPhysicalDevice phys_dev, VkDevice device, uint32_t queue_fam,
+			 uint32_t frame_ct, uint32_t max_scopes = DEFAULT_MAX_SCOPES);
+		~Profiler();
+
+		Profiler(const Profiler&) = delete;
+		auto operator=(const Profiler&) -> Profiler& = delete;
+
+		// Collects the results from the last time this frame slot was
+		// used and resets its queries. Has to be recorded outside of
+		// a render pass, before any scopes, and only once the frame's
+		// previous submission has finished.
+		void begin_frame(VkCommandBuffer cbuf, uint32_t frame_idx);
+
+		auto begin(VkCommandBuffer cbuf, const std::string& name) -> uint32_t;
+		void end(VkCommandBuffer cbuf, uint32_t scope);
+
+		auto supported() const -> bool;
+
+		// Sorted by name
+		auto stats() const -> std::vector<ScopeStats>;
+		void print_stats(std::ostream& out) const;
+
+	private:
+		struct Scope {
+			uint32_t name_idx;
+			uint32_t first_query;
+		};
+
+		struct FrameQueries {
+			VkQueryPool pool;
+			std::vector<Scope> scopes;
+		};
+
+		// Ring of the most recent samples, in milliseconds
+		struct Samples {
+			std::string name;
+			std::vector<double> ring;
+			uint32_t next;
+		};
+
+		VkDevice device;
+		uint32_t max_scopes;
+		// Nanoseconds per tick
+		double period;
+		// Timestamps only have this many valid bits
+		uint64_t mask;
+
+		std::vector<FrameQueries> frames;
+		uint32_t frame_idx = 0;
+
+		std::unordered_map<std::string, uint32_t> name_indices;
+		std::vector<Samples> samples;
+
+		void collect(FrameQueries& frame);
+	};
+}
+
+#endif // LL_QUERY_H
@@ -1,7 +1,9 @@
 #include "queue.hpp"
 
-#include <vector>
+#include <algorithm>
+#include <stdexcept>
 #include <unordered_set>
+#include <vector>
 
 namespace ll::queue {
 	QueueFamilies::QueueFamilies(VkPhysicalDevice phys_dev, std::optional<VkSurfaceKHR> surface) {
@@ -13,36 +15,88 @@ namespace ll::queue {
 		std::vector<VkQueueFamilyProperties> queue_fams(queue_fam_ct);
 		vkGetPhysicalDeviceQueueFamilyProperties(phys_dev, &queue_fam_ct,
 							 queue_fams.data());
-		
+
+		std::optional<uint32_t> both;
+
+		// Look at every family rather than stopping at the first
+		// match, the dedicated ones tend to come last
 		for (uint32_t i = 0; i < queue_fam_ct; ++i) {
-			if (queue_fams[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
-				graphics = i;
-
-                        if (surface.has_value()) {
-				VkBool32 present_supported = VK_FALSE;
-				vkGetPhysicalDeviceSurfaceSupportKHR(
-					phys_dev, i, surface.value(), &present_supported);
-				if (present_supported)
-					present = i;
-                        }
-                        if (graphics.has_value() && present.has_value())
-				break;
+			auto flags = queue_fams[i].queueFlags;
+			queue_cts.push_back(queue_fams[i].queueCount);
+
+			bool present_supported = false;
+			if (surface.has_value()) {
+				VkBool32 supported = VK_FALSE;
+				vkGetPhysicalDeviceSurfaceSupportKHR(phys_dev, i, surface.value(), &supported);
+				present_supported = supported == VK_TRUE;
+			}
+
+			if ((flags & VK_QUEUE_GRAPHICS_BIT) && !graphics.has_value()) graphics = i;
+			if (present_supported && !present.has_value()) present = i;
+			// Prefer a family that can do both, so the swapchain
+			// doesn't have to be shared
+			if ((flags & VK_QUEUE_GRAPHICS_BIT) && present_supported && !both.has_value()) both = i;
+
+			if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)
+			    && !compute.has_value())
+				compute = i;
+
+			if ((flags & VK_QUEUE_TRANSFER_BIT)
+			    && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+			    && !transfer.has_value())
+				transfer = i;
 		}
-		
+
+		if (both.has_value()) graphics = present = both;
+
+		// Graphics families don't have to support compute, so only
+		// fall back to one that says it does
+		if (!compute.has_value() && graphics.has_value()
+		    && (queue_fams[graphics.value()].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+			compute = graphics;
+			compute_idx = queue_cts[graphics.value()] > 1 ? 1 : 0;
+		}
+
 		std::unordered_set<uint32_t> fam_set;
 		if (graphics.has_value()) fam_set.insert(graphics.value());
 		if (present.has_value()) fam_set.insert(present.value());
 
 		unique = std::vector<uint32_t>(fam_set.begin(), fam_set.end());
-        }
+	}
+
+	auto QueueFamilies::device_queues() const -> std::vector<std::pair<uint32_t, uint32_t>> {
+		std::vector<std::pair<uint32_t, uint32_t>> out;
+		auto add = [&](std::optional<uint32_t> fam, uint32_t queue_ct) {
+			if (!fam.has_value()) return;
+			auto existing = std::find_if(out.begin(), out.end(),
+						     [&](const auto& p) { return p.first == fam.value(); });
+			if (existing == out.end()) out.emplace_back(fam.value(), queue_ct);
+			else existing->second = std::max(existing->second, queue_ct);
+		};
+
+		add(graphics, 1);
+		add(present, 1);
+		add(transfer, 1);
+		add(compute, compute_idx + 1);
+
+		return out;
+	}
 
 	Queues::Queues(VkDevice device, QueueFamilies queue_fams) {
 		if (queue_fams.graphics.has_value())
 			vkGetDeviceQueue(device, queue_fams.graphics.value(), 0, &graphics);
 		if (queue_fams.present.has_value()) {
-			if (queue_fams.present.value() == queue_fams.graphics.value())
+			if (queue_fams.present == queue_fams.graphics)
 				present = graphics;
 			else vkGetDeviceQueue(device, queue_fams.present.value(), 0, &present);
 		}
+		if (queue_fams.transfer.has_value())
+			vkGetDeviceQueue(device, queue_fams.transfer.value(), 0, &transfer);
+		if (queue_fams.compute.has_value())
+			vkGetDeviceQueue(device, queue_fams.compute.value(), queue_fams.compute_idx, &compute);
+	}
+
+	auto Queues::async_compute() const -> bool {
+		return compute != VK_NULL_HANDLE && compute != graphics;
 	}
 }
@@ -3,28 +3,59 @@
 
 #include <vulkan/vulkan.h>
 #include <optional>
+#include <utility>
 #include <vector>
 
 namespace ll::queue {
 	struct QueueFamilies {
 		std::optional<uint32_t> graphics;
 		std::optional<uint32_t> present;
-
+		// A family that can only do transfers, which usually maps to
+		// the GPU's copy engines. Not set if there isn't one.
+		std::optional<uint32_t> transfer;
+		// Where async compute work goes: a family that can do compute
+		// but not graphics, or the graphics family if there isn't one
+		// and it supports compute. Not set otherwise.
+		std::optional<uint32_t> compute;
+		// Index of the compute queue in its family. When compute shares
+		// the graphics family this is 1 if the family has a second
+		// queue, so the two can still overlap, and 0 otherwise.
+		uint32_t compute_idx = 0;
+
+		// Graphics and present, without duplicates. These are the
+		// families the swapchain images are shared between.
 		std::vector<uint32_t> unique;
 
+		// Number of queues in each family, indexed by family
+		std::vector<uint32_t> queue_cts;
+
 		QueueFamilies() = default;
 
 		// Surface can be empty if you don't care about present support
 		QueueFamilies(VkPhysicalDevice phys_dev, std::optional<VkSurfaceKHR> surface = std::nullopt);
+
+		// Every family above without duplicates, paired with how many
+		// queues the device has to create from it. Can be passed
+		// straight to ll::device::default_queue_infos.
+		auto device_queues() const -> std::vector<std::pair<uint32_t, uint32_t>>;
 	};
 
-	// Any that don't exist will be VK_NULL_HANDLE
+	// Any that don't exist will be VK_NULL_HANDLE. Compute falls back to
+	// the graphics queue if the device has nothing better, so check
+	// async_compute() before expecting any overlap.
 	struct Queues {
 		VkQueue graphics = VK_NULL_HANDLE;
 		VkQueue present = VK_NULL_HANDLE;
+		VkQueue transfer = VK_NULL_HANDLE;
+		VkQueue compute = VK_NULL_HANDLE;
 
+		// The device must have been created with
+		// queue_fams.device_queues()
 		Queues(VkDevice device, QueueFamilies queue_fams);
 		Queues() = default;
+
+		// Whether compute work can run alongside graphics work
+		auto async_compute() const -> bool;
 	};
 }
 
@@ -1,6 +1,8 @@
 #include "rpass.hpp"
 
+#include <algorithm>
 #include <stdexcept>
+#include <tuple>
 
 namespace ll::rpass {
 	auto attachment(VkFormat format,
@@ -26,13 +28,17 @@ namespace ll::rpass {
 		return info;
 	}
 
-	auto subpass(uint32_t color_ref_ct, VkAttachmentReference* color_refs, SubpassSettings settings)
+	auto subpass(uint32_t color_ref_ct, VkAttachmentReference* color_refs,
+		     const VkAttachmentReference* depth_ref, const VkAttachmentReference* resolve_refs,
+		     SubpassSettings settings)
 		-> VkSubpassDescription
 	{
 		VkSubpassDescription info{};
 		info.pipelineBindPoint = settings.bind_point;
 		info.colorAttachmentCount = color_ref_ct;
 		info.pColorAttachments = color_refs;
+		info.pResolveAttachments = resolve_refs;
+		info.pDepthStencilAttachment = depth_ref;
 
 		return info;
 	}
@@ -63,4 +69,127 @@ namespace ll::rpass {
 
 		return rpass;
 	}
+
+	auto framebuffer(VkDevice device, VkRenderPass rpass,
+			 uint32_t attachment_ct, const VkImageView* attachments,
+			 uint32_t width, uint32_t height)
+		-> VkFramebuffer
+	{
+		VkFramebufferCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		info.renderPass = rpass;
+		info.attachmentCount = attachment_ct;
+		info.pAttachments = attachments;
+		info.width = width;
+		info.height = height;
+		info.layers = 1;
+
+		VkFramebuffer fb{};
+		if (vkCreateFramebuffer(device, &info, nullptr, &fb) != VK_SUCCESS)
+			throw std::runtime_error("Could not create framebuffer!");
+
+		return fb;
+	}
+
+	auto rpass(VkDevice device, const RpassDesc& desc) -> VkRenderPass {
+		if (!desc.resolves.empty() && desc.resolves.size() != desc.colors.size())
+			throw std::runtime_error("Need one resolve reference per color reference!");
+
+		// The subpass only points at them, they're never written
+		auto colors = const_cast<VkAttachmentReference*>(desc.colors.data());
+		auto info = subpass(desc.colors.size(), colors, desc.depth.has_value() ? &desc.depth.value() : nullptr,
+				    desc.resolves.empty() ? nullptr : desc.resolves.data());
+		auto attachments = const_cast<VkAttachmentDescription*>(desc.attachments.data());
+		auto dependencies = const_cast<VkSubpassDependency*>(desc.dependencies.data());
+
+		return rpass(device, desc.attachments.size(), attachments, 1, &info,
+			     desc.dependencies.size(), dependencies);
+	}
+
+	/*
+	 * RpassCache
+	 */
+	RpassCache::RpassCache(VkDevice device) : device(device) {}
+
+	RpassCache::~RpassCache() {
+		for (auto& [key, rpass] : rpasses) vkDestroyRenderPass(device, rpass, nullptr);
+	}
+
+	auto RpassCache::get(const RpassDesc& desc) -> VkRenderPass {
+		// Counts go first, so descriptions with differently sized lists
+		// can't flatten to the same key
+		Key key = {static_cast<uint32_t>(desc.attachments.size()), static_cast<uint32_t>(desc.colors.size()),
+			   static_cast<uint32_t>(desc.resolves.size()), desc.depth.has_value() ? 1U : 0U,
+			   static_cast<uint32_t>(desc.dependencies.size())};
+		for (const auto& a : desc.attachments)
+			key.insert(key.end(), {a.flags, a.format, a.samples, a.loadOp, a.storeOp,
+					       a.stencilLoadOp, a.stencilStoreOp, a.initialLayout, a.finalLayout});
+		for (const auto& r : desc.colors) key.insert(key.end(), {r.attachment, r.layout});
+		for (const auto& r : desc.resolves) key.insert(key.end(), {r.attachment, r.layout});
+		if (desc.depth.has_value()) key.insert(key.end(), {desc.depth->attachment, desc.depth->layout});
+		for (const auto& d : desc.dependencies)
+			key.insert(key.end(), {d.srcSubpass, d.dstSubpass, d.srcStageMask, d.dstStageMask,
+					       d.srcAccessMask, d.dstAccessMask, d.dependencyFlags});
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto existing = rpasses.find(key);
+		if (existing != rpasses.end()) return existing->second;
+
+		auto created = rpass(device, desc);
+		rpasses.emplace(std::move(key), created);
+
+		return created;
+	}
+
+	auto RpassCache::size() const -> size_t {
+		std::lock_guard<std::mutex> lock(mutex);
+		return rpasses.size();
+	}
+
+	/*
+	 * FramebufferCache
+	 */
+	auto FramebufferCache::Key::operator<(const Key& other) const -> bool {
+		return std::tie(rpass, views, width, height) < std::tie(other.rpass, other.views, other.width, other.height);
+	}
+
+	FramebufferCache::FramebufferCache(VkDevice device) : device(device) {}
+
+	FramebufferCache::~FramebufferCache() {
+		for (auto& [key, fb] : fbs) vkDestroyFramebuffer(device, fb, nullptr);
+	}
+
+	auto FramebufferCache::get(VkRenderPass rpass, const std::vector<VkImageView>& views,
+				   uint32_t width, uint32_t height) -> VkFramebuffer
+	{
+		Key key{rpass, views, width, height};
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto existing = fbs.find(key);
+		if (existing != fbs.end()) return existing->second;
+
+		auto created = framebuffer(device, rpass, views.size(), views.data(), width, height);
+		fbs.emplace(std::move(key), created);
+
+		return created;
+	}
+
+	void FramebufferCache::evict(VkImageView view) {
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto it = fbs.begin(); it != fbs.end();) {
+			auto& views = it->first.views;
+			if (std::find(views.begin(), views.end(), view) == views.end()) {
+				++it;
+				continue;
+			}
+
+			vkDestroyFramebuffer(device, it->second, nullptr);
+			it = fbs.erase(it);
+		}
+	}
+
+	auto FramebufferCache::size() const -> size_t {
+		std::lock_guard<std::mutex> lock(mutex);
+		return fbs.size();
+	}
 }
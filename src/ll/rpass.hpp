@@ -2,6 +2,9 @@
 #define LL_RPASS_H_
 
 #include <vulkan/vulkan.h>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <vector>
 
 namespace ll::rpass {
@@ -25,6 +28,42 @@ namespace ll::rpass {
 		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
 	};
 
+	// Depth is only needed while the subpass runs, so it's cleared and
+	// never written out. Use a STORE store op if a later pass reads it.
+	const AttachmentSettings DEPTH_ATTACHMENT_DEFAULTS {
+		VK_SAMPLE_COUNT_1_BIT,
+		VK_ATTACHMENT_LOAD_OP_CLEAR,
+		VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+	};
+
+	// A multisampled color attachment that is resolved within the
+	// subpass, so the samples themselves are thrown away. Set samples.
+	const AttachmentSettings MSAA_ATTACHMENT_DEFAULTS {
+		VK_SAMPLE_COUNT_4_BIT,
+		VK_ATTACHMENT_LOAD_OP_CLEAR,
+		VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+	};
+
+	// What a multisampled attachment resolves into. Every pixel is
+	// overwritten, so the old contents don't have to be loaded.
+	const AttachmentSettings RESOLVE_ATTACHMENT_DEFAULTS {
+		VK_SAMPLE_COUNT_1_BIT,
+		VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		VK_ATTACHMENT_STORE_OP_STORE,
+		VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+	};
+
 	struct SubpassSettings {
 		VkPipelineBindPoint bind_point;
 	};
@@ -43,12 +82,32 @@ namespace ll::rpass {
 		0 // dependencyFlags
 	};
 
+	// Like DEPENDENCY_DEFAULTS, but also waits for the previous frame's
+	// depth tests before clearing a depth attachment
+	const VkSubpassDependency DEPTH_DEPENDENCY_DEFAULTS {
+		VK_SUBPASS_EXTERNAL, // srcSubpass
+		0, // dstSubpass
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+			| VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, // srcStageMask
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+			| VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, // dstStageMask
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, // srcAccessMask
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+			| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, // dstAccessMask
+		0 // dependencyFlags
+	};
+
 	auto attachment(VkFormat format, AttachmentSettings settings = ATTACHMENT_DEFAULTS)
 		-> VkAttachmentDescription;
 
 	auto attachment_ref(uint32_t idx, VkImageLayout layout) -> VkAttachmentReference;
 
+	// Depth_ref may be null. Resolve_refs is either null or has one
+	// reference per color reference (VK_ATTACHMENT_UNUSED for the ones
+	// that aren't resolved). All references must outlive rpass().
 	auto subpass(uint32_t color_ref_ct, VkAttachmentReference* color_refs,
+		     const VkAttachmentReference* depth_ref = nullptr,
+		     const VkAttachmentReference* resolve_refs = nullptr,
 		     SubpassSettings settings = SUBPASS_DEFAULTS)
 		-> VkSubpassDescription;
 
@@ -59,6 +118,87 @@ namespace ll::rpass {
 		   uint32_t subpass_ct, VkSubpassDescription* subpasses,
 		   uint32_t dependecy_ct, VkSubpassDependency* dependencies)
 		-> VkRenderPass;
+
+	auto framebuffer(VkDevice device, VkRenderPass rpass,
+			 uint32_t attachment_ct, const VkImageView* attachments,
+			 uint32_t width, uint32_t height)
+		-> VkFramebuffer;
+
+	// A render pass with a single subpass. The references index into
+	// attachments.
+	struct RpassDesc {
+		std::vector<VkAttachmentDescription> attachments;
+		std::vector<VkAttachmentReference> colors;
+		// Either empty or one per color reference
+		std::vector<VkAttachmentReference> resolves;
+		std::optional<VkAttachmentReference> depth;
+		std::vector<VkSubpassDependency> dependencies;
+	};
+
+	auto rpass(VkDevice device, const RpassDesc& desc) -> VkRenderPass;
+
+	// Hands out one VkRenderPass per distinct description: attachment
+	// formats, sample counts, load and store ops, layouts, references and
+	// dependencies. Render passes live as long as the cache, so things
+	// rebuilt on resize (which doesn't change any of that) get the same
+	// one back, and so do pipelines built against it.
+	//
+	// Thread-safe.
+	struct RpassCache {
+		explicit RpassCache(VkDevice device);
+		~RpassCache();
+
+		RpassCache(const RpassCache&) = delete;
+		auto operator=(const RpassCache&) -> RpassCache& = delete;
+
+		auto get(const RpassDesc& desc) -> VkRenderPass;
+
+		auto size() const -> size_t;
+
+	private:
+		// Every field of the description, flattened
+		using Key = std::vector<uint32_t>;
+
+		VkDevice device;
+		std::map<Key, VkRenderPass> rpasses;
+		mutable std::mutex mutex;
+	};
+
+	// Hands out one VkFramebuffer per render pass, set of image views and
+	// extent. Framebuffers stay around until one of their views is
+	// evicted, which has to happen before the view is destroyed.
+	//
+	// Thread-safe.
+	struct FramebufferCache {
+		explicit FramebufferCache(VkDevice device);
+		~FramebufferCache();
+
+		FramebufferCache(const FramebufferCache&) = delete;
+		auto operator=(const FramebufferCache&) -> FramebufferCache& = delete;
+
+		auto get(VkRenderPass rpass, const std::vector<VkImageView>& views, uint32_t width, uint32_t height)
+			-> VkFramebuffer;
+
+		// Destroys every framebuffer using view. Only call once the
+		// GPU is done with them, e.g. right before destroying the view.
+		void evict(VkImageView view);
+
+		auto size() const -> size_t;
+
+	private:
+		struct Key {
+			VkRenderPass rpass;
+			std::vector<VkImageView> views;
+			uint32_t width;
+			uint32_t height;
+
+			auto operator<(const Key& other) const -> bool;
+		};
+
+		VkDevice device;
+		std::map<Key, VkFramebuffer> fbs;
+		mutable std::mutex mutex;
+	};
 }
 
 #endif // LL_RPASS_H_
@@ -1,7 +1,12 @@
 #include "shader.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <map>
 #include <stdexcept>
+#include <unordered_map>
+#include <utility>
 
 namespace ll::shader {
 	auto read_bytes(const char* filename) -> std::vector<char> {
@@ -35,7 +40,7 @@ namespace ll::shader {
 
 	auto create(VkDevice device, VkShaderStageFlagBits stage, const std::vector<char>& bytes) -> Shader {
 		Shader shader{};
-		auto module = create_module(device, bytes); 
+		auto module = create_module(device, bytes);
 
 		shader.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shader.stage = stage;
@@ -52,4 +57,520 @@ namespace ll::shader {
 	void destroy(VkDevice device, Shader shader) {
 		vkDestroyShaderModule(device, shader.module, nullptr);
 	}
+
+	/*
+	 * Reflection
+	 */
+	// The few parts of the SPIR-V spec reflect() needs
+	const uint32_t SPV_MAGIC = 0x07230203;
+	const size_t SPV_HEADER_WORDS = 5;
+
+	const uint32_t OP_NAME = 5;
+	const uint32_t OP_ENTRY_POINT = 15;
+	const uint32_t OP_TYPE_BOOL = 20;
+	const uint32_t OP_TYPE_INT = 21;
+	const uint32_t OP_TYPE_FLOAT = 22;
+	const uint32_t OP_TYPE_VECTOR = 23;
+	const uint32_t OP_TYPE_MATRIX = 24;
+	const uint32_t OP_TYPE_IMAGE = 25;
+	const uint32_t OP_TYPE_SAMPLER = 26;
+	const uint32_t OP_TYPE_SAMPLED_IMAGE = 27;
+	const uint32_t OP_TYPE_ARRAY = 28;
+	const uint32_t OP_TYPE_RUNTIME_ARRAY = 29;
+	const uint32_t OP_TYPE_STRUCT = 30;
+	const uint32_t OP_TYPE_POINTER = 32;
+	const uint32_t OP_CONSTANT = 43;
+	const uint32_t OP_SPEC_CONSTANT_TRUE = 48;
+	const uint32_t OP_SPEC_CONSTANT_FALSE = 49;
+	const uint32_t OP_SPEC_CONSTANT = 50;
+	const uint32_t OP_VARIABLE = 59;
+	const uint32_t OP_DECORATE = 71;
+	const uint32_t OP_MEMBER_DECORATE = 72;
+
+	const uint32_t DECORATION_SPEC_ID = 1;
+	const uint32_t DECORATION_BUFFER_BLOCK = 3;
+	const uint32_t DECORATION_ROW_MAJOR = 4;
+	const uint32_t DECORATION_ARRAY_STRIDE = 6;
+	const uint32_t DECORATION_MATRIX_STRIDE = 7;
+	const uint32_t DECORATION_BUILT_IN = 11;
+	const uint32_t DECORATION_LOCATION = 30;
+	const uint32_t DECORATION_BINDING = 33;
+	const uint32_t DECORATION_DESCRIPTOR_SET = 34;
+	const uint32_t DECORATION_OFFSET = 35;
+
+	const uint32_t STORAGE_UNIFORM_CONSTANT = 0;
+	const uint32_t STORAGE_INPUT = 1;
+	const uint32_t STORAGE_UNIFORM = 2;
+	const uint32_t STORAGE_PUSH_CONSTANT = 9;
+	const uint32_t STORAGE_STORAGE_BUFFER = 12;
+
+	const uint32_t DIM_BUFFER = 5;
+	const uint32_t DIM_SUBPASS_DATA = 6;
+	// OpTypeImage's "sampled" operand, 2 means it's used without a sampler
+	const uint32_t IMAGE_STORAGE = 2;
+
+	// Everything reflect() needs from a module, by result ID
+	struct Module {
+		struct Type {
+			uint32_t op;
+			// The instruction's operands after the result ID
+			std::vector<uint32_t> operands;
+		};
+
+		struct Decorations {
+			std::optional<uint32_t> set;
+			std::optional<uint32_t> binding;
+			std::optional<uint32_t> location;
+			std::optional<uint32_t> spec_id;
+			uint32_t array_stride = 0;
+			bool buffer_block = false;
+			bool built_in = false;
+		};
+
+		struct MemberDecorations {
+			uint32_t offset = 0;
+			uint32_t matrix_stride = 0;
+			bool row_major = false;
+		};
+
+		struct Variable {
+			uint32_t id;
+			uint32_t type;
+			uint32_t storage;
+		};
+
+		std::optional<uint32_t> execution_model;
+		std::unordered_map<uint32_t, std::string> names;
+		std::unordered_map<uint32_t, Type> types;
+		std::unordered_map<uint32_t, Decorations> decorations;
+		// By (struct, member)
+		std::map<std::pair<uint32_t, uint32_t>, MemberDecorations> members;
+		// First word of each (spec) constant, for array lengths
+		std::unordered_map<uint32_t, uint32_t> constants;
+		std::vector<Variable> variables;
+		// (result ID, type) of every specialization constant
+		std::vector<std::pair<uint32_t, uint32_t>> spec_constants;
+
+		auto type(uint32_t id) const -> const Type& {
+			auto it = types.find(id);
+			if (it == types.end()) throw std::runtime_error("SPIR-V references an unknown type!");
+			return it->second;
+		}
+
+		auto decorations_of(uint32_t id) const -> Decorations {
+			auto it = decorations.find(id);
+			return it == decorations.end() ? Decorations{} : it->second;
+		}
+
+		auto member(uint32_t id, uint32_t idx) const -> MemberDecorations {
+			auto it = members.find({id, idx});
+			return it == members.end() ? MemberDecorations{} : it->second;
+		}
+
+		auto constant(uint32_t id) const -> uint32_t {
+			auto it = constants.find(id);
+			if (it == constants.end()) throw std::runtime_error("SPIR-V array length isn't a constant!");
+			return it->second;
+		}
+
+		// Bytes taken by a value of the type in an explicitly laid out
+		// block. Matrix_stride and row_major come from the struct
+		// member holding the value.
+		auto size(uint32_t id, uint32_t matrix_stride = 0, bool row_major = false) const -> uint32_t {
+			auto& t = type(id);
+			switch (t.op) {
+			case OP_TYPE_BOOL: return sizeof(VkBool32);
+			case OP_TYPE_INT:
+			case OP_TYPE_FLOAT: return t.operands[0] / 8;
+			case OP_TYPE_VECTOR: return t.operands[1] * size(t.operands[0]);
+			case OP_TYPE_MATRIX: {
+				auto columns = t.operands[1];
+				if (matrix_stride == 0) return columns * size(t.operands[0]);
+				auto rows = type(t.operands[0]).operands[1];
+				return (row_major ? rows : columns) * matrix_stride;
+			}
+			case OP_TYPE_ARRAY: {
+				auto stride = decorations_of(id).array_stride;
+				if (stride == 0) stride = size(t.operands[0], matrix_stride, row_major);
+				return constant(t.operands[1]) * stride;
+			}
+			// Only allowed last, and takes up whatever is left
+			case OP_TYPE_RUNTIME_ARRAY: return 0;
+			case OP_TYPE_STRUCT: return struct_end(id);
+			default: throw std::runtime_error("SPIR-V block member has an unsupported type!");
+			}
+		}
+
+		// Where the struct's last member ends
+		auto struct_end(uint32_t id) const -> uint32_t {
+			auto& t = type(id);
+			uint32_t end = 0;
+			for (uint32_t i = 0; i < t.operands.size(); ++i) {
+				auto m = member(id, i);
+				end = std::max(end, m.offset + size(t.operands[i], m.matrix_stride, m.row_major));
+			}
+			return end;
+		}
+	};
+
+	static auto to_words(const std::vector<char>& bytes) -> std::vector<uint32_t> {
+		if (bytes.size() % sizeof(uint32_t) != 0 || bytes.size() < SPV_HEADER_WORDS * sizeof(uint32_t))
+			throw std::runtime_error("Not a SPIR-V module!");
+
+		// The bytes might not be aligned for uint32_t
+		std::vector<uint32_t> words(bytes.size() / sizeof(uint32_t));
+		std::memcpy(words.data(), bytes.data(), bytes.size());
+		if (words[0] != SPV_MAGIC) throw std::runtime_error("Not a SPIR-V module!");
+
+		return words;
+	}
+
+	// Literal strings are nul-terminated and padded to whole words
+	static auto literal_string(const uint32_t* words, size_t word_ct) -> std::string {
+		auto chars = reinterpret_cast<const char*>(words);
+		return std::string(chars, std::find(chars, chars + word_ct * sizeof(uint32_t), '\0'));
+	}
+
+	// Words after the opcode that parse() and the lookups on Module
+	// read, counting the result ID. Optional operands aren't included.
+	static auto min_arg_ct(uint32_t op) -> size_t {
+		switch (op) {
+		case OP_TYPE_BOOL:
+		case OP_TYPE_SAMPLER:
+		case OP_TYPE_STRUCT: return 1;
+		case OP_NAME:
+		case OP_TYPE_FLOAT:
+		case OP_TYPE_SAMPLED_IMAGE:
+		case OP_TYPE_RUNTIME_ARRAY:
+		case OP_SPEC_CONSTANT_TRUE:
+		case OP_SPEC_CONSTANT_FALSE:
+		case OP_DECORATE: return 2;
+		case OP_ENTRY_POINT:
+		case OP_TYPE_INT:
+		case OP_TYPE_VECTOR:
+		case OP_TYPE_MATRIX:
+		case OP_TYPE_ARRAY:
+		case OP_TYPE_POINTER:
+		case OP_CONSTANT:
+		case OP_SPEC_CONSTANT:
+		case OP_VARIABLE:
+		case OP_MEMBER_DECORATE: return 3;
+		case OP_TYPE_IMAGE: return 8;
+		default: return 0;
+		}
+	}
+
+	static auto parse(const std::vector<uint32_t>& words) -> Module {
+		Module module;
+
+		for (size_t i = SPV_HEADER_WORDS; i < words.size();) {
+			auto op = words[i] & 0xFFFF;
+			size_t word_ct = words[i] >> 16;
+			if (word_ct == 0 || i + word_ct > words.size())
+				throw std::runtime_error("SPIR-V module is truncated!");
+
+			auto args = words.data() + i + 1;
+			auto arg_ct = word_ct - 1;
+			i += word_ct;
+			if (arg_ct < min_arg_ct(op))
+				throw std::runtime_error("SPIR-V instruction is missing operands!");
+
+			switch (op) {
+			case OP_NAME:
+				module.names[args[0]] = literal_string(args + 1, arg_ct - 1);
+				break;
+			case OP_ENTRY_POINT:
+				if (!module.execution_model.has_value()) module.execution_model = args[0];
+				break;
+			case OP_TYPE_BOOL:
+			case OP_TYPE_INT:
+			case OP_TYPE_FLOAT:
+			case OP_TYPE_VECTOR:
+			case OP_TYPE_MATRIX:
+			case OP_TYPE_IMAGE:
+			case OP_TYPE_SAMPLER:
+			case OP_TYPE_SAMPLED_IMAGE:
+			case OP_TYPE_ARRAY:
+			case OP_TYPE_RUNTIME_ARRAY:
+			case OP_TYPE_STRUCT:
+			case OP_TYPE_POINTER:
+				module.types[args[0]] = {op, std::vector<uint32_t>(args + 1, args + arg_ct)};
+				break;
+			case OP_CONSTANT:
+				module.constants[args[1]] = args[2];
+				break;
+			case OP_SPEC_CONSTANT_TRUE:
+			case OP_SPEC_CONSTANT_FALSE:
+				module.constants[args[1]] = op == OP_SPEC_CONSTANT_TRUE;
+				module.spec_constants.emplace_back(args[1], args[0]);
+				break;
+			case OP_SPEC_CONSTANT:
+				module.constants[args[1]] = args[2];
+				module.spec_constants.emplace_back(args[1], args[0]);
+				break;
+			case OP_VARIABLE:
+				module.variables.push_back({args[1], args[0], args[2]});
+				break;
+			case OP_DECORATE: {
+				auto& d = module.decorations[args[0]];
+				auto value = arg_ct > 2 ? args[2] : 0;
+				switch (args[1]) {
+				case DECORATION_SPEC_ID: d.spec_id = value; break;
+				case DECORATION_BUFFER_BLOCK: d.buffer_block = true; break;
+				case DECORATION_ARRAY_STRIDE: d.array_stride = value; break;
+				case DECORATION_BUILT_IN: d.built_in = true; break;
+				case DECORATION_LOCATION: d.location = value; break;
+				case DECORATION_BINDING: d.binding = value; break;
+				case DECORATION_DESCRIPTOR_SET: d.set = value; break;
+				default: break;
+				}
+				break;
+			}
+			case OP_MEMBER_DECORATE: {
+				auto& m = module.members[{args[0], args[1]}];
+				auto value = arg_ct > 3 ? args[3] : 0;
+				switch (args[2]) {
+				case DECORATION_ROW_MAJOR: m.row_major = true; break;
+				case DECORATION_MATRIX_STRIDE: m.matrix_stride = value; break;
+				case DECORATION_OFFSET: m.offset = value; break;
+				default: break;
+				}
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		return module;
+	}
+
+	static auto stage(uint32_t execution_model) -> VkShaderStageFlagBits {
+		switch (execution_model) {
+		case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+		case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+		default: throw std::runtime_error("Unsupported shader stage!");
+		}
+	}
+
+	static auto descriptor_type(const Module& module, uint32_t type, uint32_t storage) -> VkDescriptorType {
+		auto& t = module.type(type);
+		switch (t.op) {
+		case OP_TYPE_SAMPLER: return VK_DESCRIPTOR_TYPE_SAMPLER;
+		case OP_TYPE_SAMPLED_IMAGE: return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		case OP_TYPE_IMAGE: {
+			auto dim = t.operands[1];
+			auto is_storage = t.operands[5] == IMAGE_STORAGE;
+			if (dim == DIM_SUBPASS_DATA) return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			if (dim == DIM_BUFFER)
+				return is_storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER
+					: VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			return is_storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		}
+		// Before SPIR-V 1.3, storage buffers are uniform blocks
+		// decorated BufferBlock
+		case OP_TYPE_STRUCT:
+			if (storage == STORAGE_STORAGE_BUFFER || module.decorations_of(type).buffer_block)
+				return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		default:
+			throw std::runtime_error("Unsupported descriptor type!");
+		}
+	}
+
+	static auto binding(const Module& module, const Module::Variable& var, VkShaderStageFlagBits stage)
+		-> Binding
+	{
+		auto d = module.decorations_of(var.id);
+
+		Binding out{};
+		out.set = d.set.value_or(0);
+		out.binding = d.binding.value();
+		out.stages = stage;
+
+		// Arrays of descriptors, possibly nested
+		out.count = 1;
+		auto type = module.type(var.type).operands[1];
+		for (;;) {
+			auto& t = module.type(type);
+			if (t.op == OP_TYPE_ARRAY) out.count *= module.constant(t.operands[1]);
+			else if (t.op == OP_TYPE_RUNTIME_ARRAY) out.count = 0;
+			else break;
+			type = t.operands[0];
+		}
+		out.type = descriptor_type(module, type, var.storage);
+
+		return out;
+	}
+
+	// Appends one input per location the variable takes up
+	static void add_inputs(const Module& module, uint32_t type, uint32_t location, std::vector<Input>& inputs) {
+		auto& t = module.type(type);
+		if (t.op == OP_TYPE_MATRIX) {
+			for (uint32_t i = 0; i < t.operands[1]; ++i) add_inputs(module, t.operands[0], location + i, inputs);
+			return;
+		}
+
+		uint32_t component_ct = 1;
+		auto component = &t;
+		if (t.op == OP_TYPE_VECTOR) {
+			component_ct = t.operands[1];
+			component = &module.type(t.operands[0]);
+		}
+		if ((component->op != OP_TYPE_INT && component->op != OP_TYPE_FLOAT) || component->operands[0] != 32)
+			throw std::runtime_error("Unsupported vertex input type!");
+
+		// Formats of 1 to 4 components
+		const VkFormat FLOAT_FORMATS[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT,
+						  VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+		const VkFormat SINT_FORMATS[] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT,
+						 VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+		const VkFormat UINT_FORMATS[] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT,
+						 VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+		auto formats = component->op == OP_TYPE_FLOAT ? FLOAT_FORMATS
+			: component->operands[1] != 0 ? SINT_FORMATS : UINT_FORMATS;
+
+		inputs.push_back({location, formats[component_ct - 1], component_ct * 4});
+	}
+
+	auto reflect(const std::vector<char>& bytes) -> Reflection {
+		auto module = parse(to_words(bytes));
+		if (!module.execution_model.has_value()) throw std::runtime_error("SPIR-V module has no entry point!");
+
+		Reflection out{};
+		out.stage = stage(*module.execution_model);
+
+		for (auto& var : module.variables) {
+			auto d = module.decorations_of(var.id);
+			auto pointee = module.type(var.type).operands[1];
+
+			switch (var.storage) {
+			case STORAGE_UNIFORM_CONSTANT:
+			case STORAGE_UNIFORM:
+			case STORAGE_STORAGE_BUFFER:
+				if (d.binding.has_value()) out.bindings.push_back(binding(module, var, out.stage));
+				break;
+			case STORAGE_PUSH_CONSTANT: {
+				auto& t = module.type(pointee);
+				uint32_t begin = UINT32_MAX;
+				for (uint32_t i = 0; i < t.operands.size(); ++i)
+					begin = std::min(begin, module.member(pointee, i).offset);
+				auto end = module.struct_end(pointee);
+				if (begin < end) out.push_range = VkPushConstantRange{out.stage, begin, end - begin};
+				break;
+			}
+			case STORAGE_INPUT:
+				if (out.stage == VK_SHADER_STAGE_VERTEX_BIT && !d.built_in && d.location.has_value())
+					add_inputs(module, pointee, *d.location, out.inputs);
+				break;
+			default:
+				break;
+			}
+		}
+
+		for (auto [id, type] : module.spec_constants) {
+			auto d = module.decorations_of(id);
+			// Constants derived from spec constants aren't decorated
+			if (!d.spec_id.has_value()) continue;
+			auto name = module.names.find(id);
+			out.spec_constants.push_back({*d.spec_id, module.size(type),
+						      name == module.names.end() ? "" : name->second});
+		}
+
+		std::sort(out.bindings.begin(), out.bindings.end(), [](const Binding& a, const Binding& b) {
+			return std::make_pair(a.set, a.binding) < std::make_pair(b.set, b.binding);
+		});
+		std::sort(out.inputs.begin(), out.inputs.end(),
+			  [](const Input& a, const Input& b) { return a.location < b.location; });
+		std::sort(out.spec_constants.begin(), out.spec_constants.end(),
+			  [](const SpecConstant& a, const SpecConstant& b) { return a.id < b.id; });
+
+		return out;
+	}
+
+	auto reflect(const char* filename) -> Reflection {
+		return reflect(read_bytes(filename));
+	}
+
+	auto set_bindings(const std::vector<Reflection>& shaders)
+		-> std::vector<std::vector<VkDescriptorSetLayoutBinding>>
+	{
+		std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
+		for (auto& shader : shaders) {
+			for (auto& b : shader.bindings) {
+				auto where = "set " + std::to_string(b.set) + " binding " + std::to_string(b.binding);
+				if (b.count == 0)
+					throw std::runtime_error("Runtime-sized array at " + where
+								 + " needs a hand-written layout!");
+
+				if (sets.size() <= b.set) sets.resize(b.set + 1);
+				auto& bindings = sets[b.set];
+				auto existing = std::find_if(bindings.begin(), bindings.end(),
+							     [&](const auto& other) { return other.binding == b.binding; });
+				if (existing == bindings.end()) {
+					VkDescriptorSetLayoutBinding binding{};
+					binding.binding = b.binding;
+					binding.descriptorType = b.type;
+					binding.descriptorCount = b.count;
+					binding.stageFlags = b.stages;
+					bindings.push_back(binding);
+				} else if (existing->descriptorType != b.type || existing->descriptorCount != b.count) {
+					throw std::runtime_error("Shaders disagree on " + where + "!");
+				} else {
+					existing->stageFlags |= b.stages;
+				}
+			}
+		}
+
+		return sets;
+	}
+
+	auto push_ranges(const std::vector<Reflection>& shaders) -> std::vector<VkPushConstantRange> {
+		std::optional<VkPushConstantRange> merged;
+		for (auto& shader : shaders) {
+			if (!shader.push_range.has_value()) continue;
+			auto& range = *shader.push_range;
+			if (!merged.has_value()) {
+				merged = range;
+				continue;
+			}
+
+			auto begin = std::min(merged->offset, range.offset);
+			auto end = std::max(merged->offset + merged->size, range.offset + range.size);
+			merged->stageFlags |= range.stageFlags;
+			merged->offset = begin;
+			merged->size = end - begin;
+		}
+
+		if (!merged.has_value()) return {};
+		return {*merged};
+	}
+
+	auto vertex_input(const Reflection& vertex, uint32_t binding) -> VertexInput {
+		if (vertex.inputs.empty()) return {};
+
+		VertexInput out;
+		uint32_t offset = 0;
+		for (auto& input : vertex.inputs) {
+			VkVertexInputAttributeDescription attribute{};
+			attribute.location = input.location;
+			attribute.binding = binding;
+			attribute.format = input.format;
+			attribute.offset = offset;
+			out.attributes.push_back(attribute);
+			offset += input.size;
+		}
+
+		VkVertexInputBindingDescription desc{};
+		desc.binding = binding;
+		desc.stride = offset;
+		desc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		out.bindings.push_back(desc);
+
+		return out;
+	}
 }
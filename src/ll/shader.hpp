@@ -2,6 +2,9 @@
 #define LL_SHADER_H
 
 #include <vulkan/vulkan.h>
+#include <cstdint>
+#include <optional>
+#include <string>
 #include <vector>
 
 namespace ll::shader {
@@ -12,6 +15,75 @@ namespace ll::shader {
 	auto create(VkDevice device, VkShaderStageFlagBits stage, const char* filename) -> Shader;
 
 	void destroy(VkDevice device, Shader shader);
+
+	// A descriptor the shader declares. Uniform and storage buffers are
+	// never dynamic, SPIR-V doesn't know the difference.
+	struct Binding {
+		uint32_t set;
+		uint32_t binding;
+		VkDescriptorType type;
+		// 0 for runtime-sized arrays
+		uint32_t count;
+		VkShaderStageFlags stages;
+	};
+
+	// A vertex shader input. Matrices take up one input per column.
+	struct Input {
+		uint32_t location;
+		VkFormat format;
+		uint32_t size;
+	};
+
+	struct SpecConstant {
+		uint32_t id;
+		// In bytes, booleans are VkBool32s
+		uint32_t size;
+		// Empty if the module was stripped of debug info
+		std::string name;
+	};
+
+	// The parts of a shader's interface that pipeline creation cares
+	// about, read from its SPIR-V
+	struct Reflection {
+		VkShaderStageFlagBits stage;
+		// Sorted by set, then binding
+		std::vector<Binding> bindings;
+		// The bytes of the push constant block the shader uses
+		std::optional<VkPushConstantRange> push_range;
+		// Vertex shaders only, sorted by location. Built-ins like
+		// gl_VertexIndex aren't included.
+		std::vector<Input> inputs;
+		// Sorted by ID
+		std::vector<SpecConstant> spec_constants;
+	};
+
+	// Only looks at the module's first entry point. Throws if bytes
+	// aren't SPIR-V, or use something pipelines can't be made from
+	// automatically (like 64-bit vertex inputs).
+	auto reflect(const std::vector<char>& bytes) -> Reflection;
+
+	auto reflect(const char* filename) -> Reflection;
+
+	// Merges the descriptors of a pipeline's shaders, indexed by set.
+	// Bindings used by several stages get all of their stages. Throws if
+	// the shaders disagree on a binding, or use a runtime-sized array
+	// (which needs a hand-written layout with binding flags).
+	auto set_bindings(const std::vector<Reflection>& shaders)
+		-> std::vector<std::vector<VkDescriptorSetLayoutBinding>>;
+
+	// A single range covering every shader's push constants, with all of
+	// their stages, or nothing if there are none. Push with all those
+	// stages.
+	auto push_ranges(const std::vector<Reflection>& shaders) -> std::vector<VkPushConstantRange>;
+
+	struct VertexInput {
+		std::vector<VkVertexInputBindingDescription> bindings;
+		std::vector<VkVertexInputAttributeDescription> attributes;
+	};
+
+	// Every input in one per-vertex binding, in location order and
+	// tightly packed, like a struct of the inputs without padding
+	auto vertex_input(const Reflection& vertex, uint32_t binding = 0) -> VertexInput;
 }
 
 #endif // LL_SHADER_H
@@ -1,5 +1,7 @@
 #include "sync.hpp"
 
+#include <stdexcept>
+
 namespace ll::sync {
 	auto semaphore(VkDevice device) -> VkSemaphore {
 		VkSemaphore sem{};
@@ -15,4 +17,47 @@ namespace ll::sync {
 		vkCreateFence(device, &info, nullptr, &fence);
 		return fence;
 	}
+
+	auto timeline(VkDevice device, uint64_t initial_value) -> VkSemaphore {
+		VkSemaphoreTypeCreateInfo type_info{};
+		type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		type_info.initialValue = initial_value;
+
+		auto info = DEFAULT_SEM;
+		info.pNext = &type_info;
+
+		VkSemaphore sem{};
+		if (vkCreateSemaphore(device, &info, nullptr, &sem) != VK_SUCCESS)
+			throw std::runtime_error("Could not create timeline semaphore!");
+		return sem;
+	}
+
+	void wait(VkDevice device, VkSemaphore sem, uint64_t value, uint64_t timeout) {
+		VkSemaphoreWaitInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		info.semaphoreCount = 1;
+		info.pSemaphores = &sem;
+		info.pValues = &value;
+
+		if (vkWaitSemaphores(device, &info, timeout) != VK_SUCCESS)
+			throw std::runtime_error("Could not wait for timeline semaphore!");
+	}
+
+	auto value(VkDevice device, VkSemaphore sem) -> uint64_t {
+		uint64_t value = 0;
+		if (vkGetSemaphoreCounterValue(device, sem, &value) != VK_SUCCESS)
+			throw std::runtime_error("Could not get timeline semaphore value!");
+		return value;
+	}
+
+	void signal(VkDevice device, VkSemaphore sem, uint64_t value) {
+		VkSemaphoreSignalInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+		info.semaphore = sem;
+		info.value = value;
+
+		if (vkSignalSemaphore(device, &info) != VK_SUCCESS)
+			throw std::runtime_error("Could not signal timeline semaphore!");
+	}
 }
@@ -2,6 +2,7 @@
 #define LL_SYNC_H
 
 #include <vulkan/vulkan.h>
+#include <cstdint>
 
 namespace ll::sync {
 	const VkSemaphoreCreateInfo DEFAULT_SEM {
@@ -19,6 +20,18 @@ namespace ll::sync {
 	auto semaphore(VkDevice device) -> VkSemaphore;
 
 	auto fence(VkDevice device, VkFenceCreateFlags flags = 0) -> VkFence;
+
+	// Timeline semaphores (Vulkan 1.2) hold a counter that only goes up.
+	// Submissions can wait for it to reach a value and signal it to a
+	// higher one, and so can the host.
+	auto timeline(VkDevice device, uint64_t initial_value = 0) -> VkSemaphore;
+
+	// Blocks until sem reaches value
+	void wait(VkDevice device, VkSemaphore sem, uint64_t value, uint64_t timeout = UINT64_MAX);
+
+	auto value(VkDevice device, VkSemaphore sem) -> uint64_t;
+
+	void signal(VkDevice device, VkSemaphore sem, uint64_t value);
 }
 
 #endif // LL_SYNC_H
@@ -1,9 +1,197 @@
 #include "loop.hpp"
 
+#include "ll/cbuf.hpp"
+#include "ll/sync.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
+
 namespace loop {
-	Loop::Loop(std::unique_ptr<Dependencies>&& deps, VkDevice device, ll::queue::Queues queues)
-		: device(device), queues(queues)
+	Loop::Loop(std::unique_ptr<Dependencies>&& deps, VkDevice device,
+		   uint32_t queue_fam, ll::queue::Queues queues, uint32_t frame_ct)
+		: device(device), queues(queues), frame_ct(frame_ct),
+		  cbuf_allocator(device, queue_fam, frame_ct), deps(std::move(deps))
 	{
+		timeline = ll::sync::timeline(device);
+		for (uint32_t i = 0; i < frame_ct; ++i)
+			image_avail_sems.push_back(ll::sync::semaphore(device));
+		frame_values.resize(frame_ct, 0);
+
+		recreate();
+	}
+
+	Loop::~Loop() {
+		ll::sync::wait(device, timeline, last_value);
+		// Presentation isn't covered by the timeline
+		if (queues.present != VK_NULL_HANDLE) vkQueueWaitIdle(queues.present);
+
+		for (auto& r : retired) r.destroy();
+		retired.clear();
+
+		for (auto sem : render_done_sems) vkDestroySemaphore(device, sem, nullptr);
+		ll::swapchain::destroy(device, swapchain);
+
+		for (auto sem : image_avail_sems) vkDestroySemaphore(device, sem, nullptr);
+		vkDestroySemaphore(device, timeline, nullptr);
+	}
+
+	void Loop::create_image_sync() {
+		// The images of the new swapchain haven't been rendered to yet
+		image_values.assign(swapchain.images.size(), 0);
+		render_done_sems.clear();
+		for (size_t i = 0; i < swapchain.images.size(); ++i)
+			render_done_sems.push_back(ll::sync::semaphore(device));
+	}
+
+	void Loop::recreate() {
+		auto old = swapchain;
+		auto old_sems = render_done_sems;
+
+		// Deps will see the old swapchain and pass it as old_swapchain
 		swapchain = deps->create_swapchain(std::as_const(*this));
+		create_image_sync();
+		deps->on_recreate(*this, old);
+
+		if (old.handle != VK_NULL_HANDLE) {
+			retire([device = device, present = queues.present, old, old_sems]() {
+				// The timeline only covers rendering, a present on
+				// the old swapchain may still be waiting on its
+				// semaphores. This runs once per recreation, so
+				// the stall doesn't matter.
+				vkQueueWaitIdle(present);
+				for (auto sem : old_sems) vkDestroySemaphore(device, sem, nullptr);
+				ll::swapchain::destroy(device, old);
+			});
+		}
+
+		must_recreate = false;
+	}
+
+	void Loop::retire(std::function<void()> destroy) {
+		retired.push_back({current_value(), std::move(destroy)});
+	}
+
+	void Loop::wait_for(VkSemaphore sem, VkPipelineStageFlags stage, uint64_t value) {
+		wait_sems.push_back(sem);
+		wait_stages.push_back(stage);
+		wait_values.push_back(value);
+	}
+
+	auto Loop::current_value() const -> uint64_t {
+		return recording ? last_value + 1 : last_value;
+	}
+
+	void Loop::collect_retired() {
+		if (retired.empty()) return;
+
+		auto completed = ll::sync::value(device, timeline);
+		auto is_finished = [&](const Retired& r) { return r.value <= completed; };
+
+		// Destroy in the order things were retired
+		auto still_pending = std::stable_partition(retired.begin(), retired.end(), is_finished);
+		for (auto it = retired.begin(); it != still_pending; ++it) it->destroy();
+		retired.erase(retired.begin(), still_pending);
+	}
+
+	auto Loop::draw(const RecordFn& record) -> bool {
+		if (must_recreate) recreate();
+
+		ll::sync::wait(device, timeline, frame_values[frame_idx]);
+		collect_retired();
+
+		uint32_t image_idx = 0;
+		auto res = vkAcquireNextImageKHR(device, swapchain.handle, UINT64_MAX,
+						 image_avail_sems[frame_idx], VK_NULL_HANDLE, &image_idx);
+		if (res == VK_ERROR_OUT_OF_DATE_KHR) {
+			must_recreate = true;
+			return false;
+		}
+		// A suboptimal image has still been acquired, so we have to draw
+		// to it and present it before recreating
+		if (res == VK_SUBOPTIMAL_KHR) must_recreate = true;
+		else if (res != VK_SUCCESS) throw std::runtime_error("Could not acquire image!");
+
+		// Wait for whoever's drawing to our image to finish. Usually
+		// that's an older frame than the one we just waited for, so
+		// there's nothing to do.
+		if (image_values[image_idx] > frame_values[frame_idx])
+			ll::sync::wait(device, timeline, image_values[image_idx]);
+
+		// Anything retired while recording has to wait for this frame.
+		// Last_value only moves on once the frame has been submitted,
+		// otherwise a failed frame would leave the destructor waiting
+		// for a value that is never signalled.
+		auto value = last_value + 1;
+		recording = true;
+
+		// Everything recorded for this frame slot last time is done
+		cbuf_allocator.begin_frame(frame_idx);
+		auto cbuf = cbuf_allocator.get();
+		try {
+			ll::cbuf::begin(cbuf, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+			record(Frame{cbuf, image_idx, frame_idx});
+			ll::cbuf::end(cbuf);
+		} catch (...) {
+			recording = false;
+			wait_sems.clear();
+			wait_stages.clear();
+			wait_values.clear();
+			throw;
+		}
+
+		wait_for(image_avail_sems[frame_idx], VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+		std::array<VkSemaphore, 2> signal_sems = {render_done_sems[image_idx], timeline};
+		// The binary semaphore's value is ignored
+		std::array<uint64_t, 2> signal_values = {0, value};
+
+		VkTimelineSemaphoreSubmitInfo timeline_info{};
+		timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timeline_info.waitSemaphoreValueCount = wait_values.size();
+		timeline_info.pWaitSemaphoreValues = wait_values.data();
+		timeline_info.signalSemaphoreValueCount = signal_values.size();
+		timeline_info.pSignalSemaphoreValues = signal_values.data();
+
+		VkSubmitInfo submit_info{};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.pNext = &timeline_info;
+		submit_info.waitSemaphoreCount = wait_sems.size();
+		submit_info.pWaitSemaphores = wait_sems.data();
+		submit_info.pWaitDstStageMask = wait_stages.data();
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &cbuf;
+		submit_info.signalSemaphoreCount = signal_sems.size();
+		submit_info.pSignalSemaphores = signal_sems.data();
+
+		auto submitted = vkQueueSubmit(queues.graphics, 1, &submit_info, VK_NULL_HANDLE) == VK_SUCCESS;
+		recording = false;
+		wait_sems.clear();
+		wait_stages.clear();
+		wait_values.clear();
+		if (!submitted) throw std::runtime_error("Could not submit!");
+
+		last_value = value;
+		frame_values[frame_idx] = value;
+		image_values[image_idx] = value;
+
+		VkPresentInfoKHR present_info{};
+		present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		present_info.waitSemaphoreCount = 1;
+		present_info.pWaitSemaphores = &render_done_sems[image_idx];
+		present_info.swapchainCount = 1;
+		present_info.pSwapchains = &swapchain.handle;
+		present_info.pImageIndices = &image_idx;
+
+		res = vkQueuePresentKHR(queues.present, &present_info);
+		if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR)
+			must_recreate = true;
+		else if (res != VK_SUCCESS)
+			throw std::runtime_error("Presenting failed with something other than out-of-date!");
+
+		frame_idx = (frame_idx + 1) % frame_ct;
+
+		return true;
 	}
 }
@@ -3,40 +3,144 @@
 
 #include "ll/swapchain.hpp"
 #include "ll/queue.hpp"
+#include "ll/cbuf.hpp"
 
 #include <vulkan/vulkan.h>
+#include <functional>
 #include <memory>
+#include <vector>
 
 namespace loop {
+	const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
 	struct Loop;
 
+	// Handed to the record callback. The command buffer has already been
+	// begun and will be ended and submitted by the loop, so the callback
+	// should only record into it.
+	struct Frame {
+		VkCommandBuffer cbuf;
+		// Index of the acquired swapchain image
+		uint32_t image_idx;
+		// Which of the frames in flight this is, useful for indexing
+		// per-frame resources
+		uint32_t frame_idx;
+	};
+
+	using RecordFn = std::function<void(const Frame&)>;
+
 	struct Dependencies {
+		// Loop.swapchain still holds the previous swapchain (or a null
+		// handle the first time around), which should be passed on as
+		// old_swapchain. It is retired by the loop afterwards.
 		virtual auto create_swapchain(const Loop&) -> ll::swapchain::Swapchain = 0;
+		// Called after every swapchain (re)creation, so anything that
+		// depends on the swapchain images can be rebuilt. Old is the
+		// previous swapchain, which may still be in use by frames in
+		// flight: anything built on it should be handed to
+		// Loop::retire() rather than destroyed immediately.
+		virtual void on_recreate(Loop&, const ll::swapchain::Swapchain& /* old */) {}
+		virtual ~Dependencies() = default;
 	};
 
 	struct Loop {
 		VkDevice device = VK_NULL_HANDLE;
 		ll::queue::Queues queues;
-		ll::swapchain::Swapchain swapchain;
-		std::vector<VkFence> image_fences;
-		std::vector<VkSemaphore> image_avail_sems;
+		ll::swapchain::Swapchain swapchain{};
+		uint32_t frame_ct;
+
+		// Signalled by every submission, with values counting up from
+		// 1. Everything the loop waits for is a value of this.
+		VkSemaphore timeline = VK_NULL_HANDLE;
+
+		// One per swapchain image, the timeline value of the last
+		// frame that rendered to it (or 0)
+		std::vector<uint64_t> image_values;
+		// One per swapchain image, since they are waited on by present
 		std::vector<VkSemaphore> render_done_sems;
 
-		Loop(std::unique_ptr<Dependencies>&& deps, VkDevice device, ll::queue::Queues queues);
-		void draw();
+		// The rest are one per frame in flight
+		std::vector<VkSemaphore> image_avail_sems;
+		// The timeline value of the slot's last submission (or 0)
+		std::vector<uint64_t> frame_values;
+
+		// Frame.cbuf comes from here. The record callback can get more
+		// buffers for the current frame from it (on the calling thread).
+		ll::cbuf::FrameAllocator cbuf_allocator;
+
+		// Set whenever acquire or present reports the swapchain as
+		// out-of-date or suboptimal, the next draw() will recreate.
+		bool must_recreate = false;
+
+		// Queue_fam is the family of queues.graphics, command buffers
+		// are allocated from it.
+		Loop(std::unique_ptr<Dependencies>&& deps, VkDevice device,
+		     uint32_t queue_fam, ll::queue::Queues queues,
+		     uint32_t frame_ct = DEFAULT_FRAMES_IN_FLIGHT);
+		~Loop();
+
+		Loop(const Loop&) = delete;
+		auto operator=(const Loop&) -> Loop& = delete;
+
+		// Returns false if no frame was drawn because the swapchain had
+		// to be recreated, in which case the caller can just try again.
+		auto draw(const RecordFn& record) -> bool;
+
+		// Does not wait for the device to go idle: the old swapchain is
+		// handed over to the new one and destroyed once every frame that
+		// might still use it has finished.
+		void recreate();
+
+		// Makes the current frame's submission also wait on sem at
+		// stage, e.g. for data coming from another queue. Value is
+		// only used for timeline semaphores. Call from the record
+		// callback.
+		void wait_for(VkSemaphore sem, VkPipelineStageFlags stage, uint64_t value = 0);
+
+		// The timeline value the frame being recorded will signal, or
+		// the last frame's outside of the record callback
+		auto current_value() const -> uint64_t;
+
+		// Destroy is called once every frame submitted so far (and the
+		// one being recorded, when called from the record callback) has
+		// finished executing, or when the loop is destroyed.
+		void retire(std::function<void()> destroy);
 
 	private:
+		struct Retired {
+			// Timeline value of the latest submission when this was
+			// retired
+			uint64_t value;
+			std::function<void()> destroy;
+		};
+
 		std::unique_ptr<Dependencies> deps;
+		uint32_t frame_idx = 0;
+
+		// The latest value that has actually been submitted
+		uint64_t last_value = 0;
+		// Set while the record callback runs, when the frame's value is
+		// last_value + 1
+		bool recording = false;
+		std::vector<Retired> retired;
+
+		// Extra waits for the next submission, on top of image_avail
+		std::vector<VkSemaphore> wait_sems;
+		std::vector<VkPipelineStageFlags> wait_stages;
+		std::vector<uint64_t> wait_values;
+
+		void collect_retired();
+
+		void create_image_sync();
 	};
 
         /*
          * maybe recreate
-         * wait for cbuf's RDF
+         * wait for the timeline to reach the frame slot's value
          * acquire image
-         * wait for image's RDF
-         * mark acquired image with RDF
+         * wait for the timeline to reach the image's value, if it hasn't
 	 * record
-         * submit
+         * submit, signalling the next timeline value
 	 * present, set must_recreate
 	 */
 }
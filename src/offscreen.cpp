@@ -0,0 +1,129 @@
+#include "offscreen.hpp"
+
+#include "ll/image.hpp"
+#include "ll/buffer.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace offscreen {
+	auto create(ll::memory::Allocator& allocator, VkDevice device,
+		    uint32_t width, uint32_t height, VkFormat format) -> Target {
+		Target target{};
+		target.format = format;
+		target.width = width;
+		target.height = height;
+
+		// Image
+		target.image = ll::image::create(device, format, width, height,
+						 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+		target.image_memory = allocator.bind(target.image, false, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		target.view = ll::image::to_view(device, target.image, format);
+
+		// Readback buffer. Cached memory makes reading it on the CPU
+		// much faster, but might not be coherent.
+		VkDeviceSize size = static_cast<VkDeviceSize>(width) * height * BYTES_PER_PIXEL;
+		target.readback = ll::buffer::create(device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		target.readback_memory = allocator.bind(target.readback, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+							VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+		target.pixels = static_cast<const uint8_t*>(target.readback_memory.mapped);
+
+		return target;
+	}
+
+	void destroy(ll::memory::Allocator& allocator, VkDevice device, const Target& target) {
+		vkDestroyBuffer(device, target.readback, nullptr);
+		allocator.free(target.readback_memory);
+
+		vkDestroyImageView(device, target.view, nullptr);
+		vkDestroyImage(device, target.image, nullptr);
+		allocator.free(target.image_memory);
+	}
+
+	void record_readback(VkCommandBuffer cbuf, const Target& target) {
+		VkBufferImageCopy region{};
+		region.bufferOffset = 0;
+		// Zero means tightly packed
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = {0, 0, 0};
+		region.imageExtent = {target.width, target.height, 1};
+
+		vkCmdCopyImageToBuffer(cbuf, target.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				       target.readback, 1, &region);
+
+		// Make the copy visible to the host once the fence signals
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = target.readback;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier(cbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+				     0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	void invalidate(const ll::memory::Allocator& allocator, const Target& target) {
+		allocator.invalidate(target.readback_memory);
+	}
+
+	void write_ppm(const Target& target, const std::string& filename) {
+		std::ofstream file(filename, std::ios::binary);
+		if (!file.is_open()) throw std::runtime_error("Could not open " + filename + "!");
+
+		file << "P6\n" << target.width << " " << target.height << "\n255\n";
+
+		std::vector<char> row(static_cast<size_t>(target.width) * 3);
+		for (uint32_t y = 0; y < target.height; ++y) {
+			auto src = target.pixels + static_cast<size_t>(y) * target.width * BYTES_PER_PIXEL;
+			for (uint32_t x = 0; x < target.width; ++x)
+				for (uint32_t c = 0; c < 3; ++c)
+					row[x * 3 + c] = static_cast<char>(src[x * BYTES_PER_PIXEL + c]);
+			file.write(row.data(), row.size());
+		}
+	}
+
+	auto compare_ppm(const Target& target, const std::string& filename, uint8_t tolerance) -> size_t {
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open()) throw std::runtime_error("Could not open " + filename + "!");
+
+		std::string magic;
+		uint32_t width = 0, height = 0, max_val = 0;
+		file >> magic >> width >> height >> max_val;
+		// Exactly one whitespace character separates the header from the data
+		file.get();
+
+		if (magic != "P6" || max_val != 255)
+			throw std::runtime_error(filename + " is not an 8-bit binary PPM!");
+		if (width != target.width || height != target.height)
+			throw std::runtime_error(filename + " does not match the target's size!");
+
+		std::vector<char> golden(static_cast<size_t>(width) * height * 3);
+		if (!file.read(golden.data(), golden.size()))
+			throw std::runtime_error(filename + " is truncated!");
+
+		size_t mismatched = 0;
+		for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i) {
+			for (size_t c = 0; c < 3; ++c) {
+				auto expected = static_cast<uint8_t>(golden[i * 3 + c]);
+				auto actual = target.pixels[i * BYTES_PER_PIXEL + c];
+				if (std::abs(expected - actual) > tolerance) {
+					mismatched++;
+					break;
+				}
+			}
+		}
+
+		return mismatched;
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+#include "ll/memory.hpp"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+
+namespace offscreen {
+	// Readback assumes 4 bytes per pixel, so only use formats like this
+	const VkFormat DEFAULT_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+	const uint32_t BYTES_PER_PIXEL = 4;
+
+	// A render pass that draws to a Target should end in
+	// VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL and include this dependency, so
+	// that the copy in record_readback() waits for rendering to finish.
+	const VkSubpassDependency READBACK_DEPENDENCY {
+		0, // srcSubpass
+		VK_SUBPASS_EXTERNAL, // dstSubpass
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, // srcStageMask
+		VK_PIPELINE_STAGE_TRANSFER_BIT, // dstStageMask
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, // srcAccessMask
+		VK_ACCESS_TRANSFER_READ_BIT, // dstAccessMask
+		0 // dependencyFlags
+	};
+
+	// A color image that isn't part of a swapchain, plus a host-visible
+	// buffer that stays mapped for as long as the target exists.
+	struct Target {
+		VkImage image;
+		ll::memory::Allocation image_memory;
+		VkImageView view;
+
+		VkBuffer readback;
+		ll::memory::Allocation readback_memory;
+		// Tightly packed rows, width * BYTES_PER_PIXEL bytes each
+		const uint8_t* pixels;
+
+		VkFormat format;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	auto create(ll::memory::Allocator& allocator, VkDevice device,
+		    uint32_t width, uint32_t height, VkFormat format = DEFAULT_FORMAT) -> Target;
+
+	void destroy(ll::memory::Allocator& allocator, VkDevice device, const Target& target);
+
+	// Records a copy of the whole image (which must be in
+	// VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) into the readback buffer.
+	void record_readback(VkCommandBuffer cbuf, const Target& target);
+
+	// Call once the submission containing record_readback() has finished,
+	// target.pixels is valid afterwards.
+	void invalidate(const ll::memory::Allocator& allocator, const Target& target);
+
+	// Writes the readback buffer as a binary PPM, dropping alpha. Only
+	// makes sense for RGBA formats.
+	void write_ppm(const Target& target, const std::string& filename);
+
+	// Returns the number of pixels where any channel differs from the
+	// golden image by more than tolerance. Throws if the golden image
+	// can't be read or its size doesn't match.
+	auto compare_ppm(const Target& target, const std::string& filename, uint8_t tolerance = 0) -> size_t;
+}
+
+#endif // OFFSCREEN_H
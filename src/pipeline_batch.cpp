@@ -0,0 +1,50 @@
+#include "pipeline_batch.hpp"
+
+#include <chrono>
+
+namespace pipeline_batch {
+	auto Batch::ready(size_t idx) const -> bool {
+		return pipelines[idx].wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	auto Batch::ready_ct() const -> size_t {
+		size_t ct = 0;
+		for (size_t i = 0; i < pipelines.size(); ++i)
+			if (ready(i)) ct++;
+		return ct;
+	}
+
+	auto Batch::get(size_t idx) const -> VkPipeline {
+		return pipelines[idx].get();
+	}
+
+	void Batch::wait() const {
+		for (const auto& pipeline : pipelines) pipeline.wait();
+	}
+
+	void Batch::destroy(VkDevice device) {
+		for (const auto& pipeline : pipelines) {
+			try {
+				vkDestroyPipeline(device, pipeline.get(), nullptr);
+			} catch (const std::exception&) {
+				// Nothing was created, so there's nothing to destroy
+			}
+		}
+		pipelines.clear();
+	}
+
+	auto compile(thread_pool::ThreadPool& pool, VkDevice device, VkPipelineCache cache,
+		     const std::vector<ll::pipeline::PipelineDesc>& descs) -> Batch {
+		Batch batch;
+		batch.pipelines.reserve(descs.size());
+
+		for (const auto& desc : descs) {
+			auto future = pool.submit([device, cache, desc]() {
+				return ll::pipeline::pipeline(device, desc, cache);
+			});
+			batch.pipelines.push_back(future.share());
+		}
+
+		return batch;
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef PIPELINE_BATCH_H
+#define PIPELINE_BATCH_H
+
+#include "thread_pool.hpp"
+#include "ll/pipeline.hpp"
+
+#include <vulkan/vulkan.h>
+#include <future>
+#include <vector>
+
+namespace pipeline_batch {
+	// Pipelines being compiled in the background, in the same order as the
+	// descriptions they came from. Rendering can start with whichever ones
+	// are ready while the rest are still compiling.
+	struct Batch {
+		std::vector<std::shared_future<VkPipeline>> pipelines;
+
+		// Doesn't block. Also true if creating the pipeline failed, in
+		// which case get() throws.
+		auto ready(size_t idx) const -> bool;
+		auto ready_ct() const -> size_t;
+
+		// Blocks until the pipeline is ready
+		auto get(size_t idx) const -> VkPipeline;
+		void wait() const;
+
+		// Waits for everything, then destroys every pipeline that was
+		// created successfully
+		void destroy(VkDevice device);
+	};
+
+	// Creates every pipeline on the pool, sharing one cache (which may be
+	// VK_NULL_HANDLE). The layouts, render passes and shader modules must
+	// stay alive until the batch is done.
+	auto compile(thread_pool::ThreadPool& pool, VkDevice device, VkPipelineCache cache,
+		     const std::vector<ll::pipeline::PipelineDesc>& descs) -> Batch;
+}
+
+#endif // PIPELINE_BATCH_H
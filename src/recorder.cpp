@@ -0,0 +1,58 @@
+#include "recorder.hpp"
+
+#include <algorithm>
+#include <future>
+
+namespace recorder {
+	Recorder::Recorder(VkDevice device, uint32_t queue_fam, uint32_t frame_ct,
+			   thread_pool::ThreadPool& pool, uint32_t slice_ct)
+		: pool(pool)
+	{
+		if (slice_ct == 0) slice_ct = pool.thread_ct();
+
+		for (uint32_t i = 0; i < slice_ct; ++i)
+			allocators.push_back(std::make_unique<ll::cbuf::FrameAllocator>(device, queue_fam, frame_ct));
+	}
+
+	Recorder::~Recorder() = default;
+
+	auto Recorder::slice_ct() const -> uint32_t {
+		return allocators.size();
+	}
+
+	void Recorder::begin_frame(uint32_t frame_idx) {
+		for (auto& allocator : allocators) allocator->begin_frame(frame_idx);
+	}
+
+	void Recorder::record(VkCommandBuffer primary,
+			      VkRenderPass rpass, uint32_t subpass, VkFramebuffer fb,
+			      size_t item_ct, const SliceFn& record_slice)
+	{
+		// Don't bother with empty slices
+		size_t slice_ct = std::min(allocators.size(), item_ct);
+		size_t per_slice = slice_ct == 0 ? 0 : (item_ct + slice_ct - 1) / slice_ct;
+
+		std::vector<VkCommandBuffer> secondaries;
+		std::vector<std::future<void>> jobs;
+		for (size_t i = 0; i < slice_ct; ++i) {
+			auto begin = i * per_slice;
+			auto end = std::min(begin + per_slice, item_ct);
+			if (begin >= end) break;
+
+			auto cbuf = allocators[i]->get(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+			secondaries.push_back(cbuf);
+			jobs.push_back(pool.submit([=, &record_slice]() {
+				ll::cbuf::begin_secondary(cbuf, rpass, subpass, fb);
+				record_slice(cbuf, begin, end);
+				ll::cbuf::end(cbuf);
+			}));
+		}
+
+		// Everything has to be finished before we return, even if
+		// something failed, since the jobs reference record_slice
+		for (auto& job : jobs) job.wait();
+		for (auto& job : jobs) job.get();
+
+		ll::cbuf::execute(primary, secondaries);
+	}
+}
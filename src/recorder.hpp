@@ -0,0 +1,59 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "thread_pool.hpp"
+#include "ll/cbuf.hpp"
+
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace recorder {
+	// Records the draws in [begin, end) into cbuf, which is a secondary
+	// command buffer that has already been begun (and will be ended by
+	// the recorder). Dynamic state isn't inherited from the primary
+	// buffer, so viewport, scissor and pipeline have to be set again.
+	// Called on a worker thread.
+	using SliceFn = std::function<void(VkCommandBuffer cbuf, size_t begin, size_t end)>;
+
+	// Splits a draw list into slices that are recorded into secondary
+	// command buffers in parallel, one slice per pool job.
+	//
+	// Every slice has its own frame allocator (so every (frame in flight,
+	// slice) pair has its own command pool) and no two threads ever touch
+	// the same pool.
+	struct Recorder {
+		Recorder(VkDevice device, uint32_t queue_fam, uint32_t frame_ct,
+			 thread_pool::ThreadPool& pool, uint32_t slice_ct = 0);
+		~Recorder();
+
+		Recorder(const Recorder&) = delete;
+		auto operator=(const Recorder&) -> Recorder& = delete;
+
+		// Resets the frame's pools, so only call this once the GPU is
+		// done with the frame, e.g. from inside loop::Loop's record
+		// callback with loop::Frame::frame_idx.
+		void begin_frame(uint32_t frame_idx);
+
+		// Can be called several times per frame. Must be called inside
+		// subpass of rpass, begun with
+		// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS. Blocks until
+		// every slice is recorded, then executes them in order, so the
+		// result is the same as recording item_ct draws inline. The
+		// first exception thrown by a slice is rethrown here.
+		void record(VkCommandBuffer primary,
+			    VkRenderPass rpass, uint32_t subpass, VkFramebuffer fb,
+			    size_t item_ct, const SliceFn& record_slice);
+
+		auto slice_ct() const -> uint32_t;
+
+	private:
+		thread_pool::ThreadPool& pool;
+		// One per slice
+		std::vector<std::unique_ptr<ll::cbuf::FrameAllocator>> allocators;
+	};
+}
+
+#endif // RECORDER_H
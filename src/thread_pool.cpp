@@ -0,0 +1,44 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace thread_pool {
+	ThreadPool::ThreadPool(uint32_t thread_ct) {
+		// hardware_concurrency() is allowed to return 0 if it doesn't know
+		if (thread_ct == 0) thread_ct = std::max(1U, std::thread::hardware_concurrency());
+
+		for (uint32_t i = 0; i < thread_ct; ++i)
+			threads.emplace_back([this]() { work(); });
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		job_added.notify_all();
+
+		for (auto& thread : threads) thread.join();
+	}
+
+	auto ThreadPool::thread_ct() const -> uint32_t {
+		return threads.size();
+	}
+
+	void ThreadPool::work() {
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				job_added.wait(lock, [this]() { return stopping || !jobs.empty(); });
+				// Only leave once the queue has been drained
+				if (jobs.empty()) return;
+
+				job = std::move(jobs.front());
+				jobs.pop();
+			}
+
+			job();
+		}
+	}
+}
@@ -0,0 +1,58 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace thread_pool {
+	// A fixed set of worker threads pulling jobs off one queue, in the
+	// order they were submitted. Destroying the pool finishes every job
+	// that was already submitted.
+	class ThreadPool {
+	public:
+		// Zero means one thread per hardware thread
+		explicit ThreadPool(uint32_t thread_ct = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+		// Exceptions thrown by the job come out of the future's get()
+		template <typename F>
+		auto submit(F&& job) -> std::future<std::invoke_result_t<F>> {
+			using Result = std::invoke_result_t<F>;
+			// std::function has to be copyable, packaged_task isn't
+			auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+			auto future = task->get_future();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				jobs.emplace([task]() { (*task)(); });
+			}
+			job_added.notify_one();
+
+			return future;
+		}
+
+		auto thread_ct() const -> uint32_t;
+
+	private:
+		std::vector<std::thread> threads;
+		std::queue<std::function<void()>> jobs;
+		std::mutex mutex;
+		std::condition_variable job_added;
+		bool stopping = false;
+
+		void work();
+	};
+}
+
+#endif // THREAD_POOL_H
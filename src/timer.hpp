@@ -3,14 +3,41 @@
 
 #include <chrono>
 #include "iostream"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
 
 namespace timer {
 	namespace chrono = std::chrono;
 
+	// Frame times are counted in buckets this wide (in milliseconds), so
+	// percentiles are accurate to within one bucket
+	const double BUCKET_WIDTH = 0.1;
+	// Covers up to 500 ms, anything longer lands in the last bucket
+	const uint32_t BUCKET_CT = 5000;
+	// A frame taking this many times longer than the median is a stutter
+	const double STUTTER_FACTOR = 2.0;
+
+	// In milliseconds
+	struct FrameStats {
+		uint64_t frame_ct;
+		double avg;
+		double p50;
+		double p95;
+		double p99;
+		double max;
+		uint64_t stutter_ct;
+	};
+
 	class Timer {
 	public:
 		Timer() {
 			begin = chrono::high_resolution_clock::now();
+			last_frame = begin;
 		}
 
 		auto get_elapsed() -> double {
@@ -24,8 +51,92 @@ namespace timer {
 			std::cout << "FPS: " << fps << std::endl;
 		}
 
+		// Call once per frame, records the time since the last call (or
+		// since the timer was created). Never allocates.
+		void frame() {
+			auto now = chrono::high_resolution_clock::now();
+			auto ms = chrono::duration<double, std::milli>(now - last_frame).count();
+			last_frame = now;
+
+			auto bucket = std::min<uint64_t>(static_cast<uint64_t>(ms / BUCKET_WIDTH), BUCKET_CT - 1);
+			histogram[bucket]++;
+			frame_ct++;
+			total_ms += ms;
+			max_ms = std::max(max_ms, ms);
+		}
+
+		auto frame_stats() const -> FrameStats {
+			FrameStats stats{};
+			stats.frame_ct = frame_ct;
+			if (frame_ct == 0) return stats;
+
+			stats.avg = total_ms / frame_ct;
+			stats.p50 = percentile(0.50);
+			stats.p95 = percentile(0.95);
+			stats.p99 = percentile(0.99);
+			stats.max = max_ms;
+
+			// Everything in a bucket starting at or above the
+			// threshold counts
+			auto threshold = static_cast<uint64_t>(std::ceil(stats.p50 * STUTTER_FACTOR / BUCKET_WIDTH));
+			for (auto i = threshold; i < BUCKET_CT; ++i) stats.stutter_ct += histogram[i];
+
+			return stats;
+		}
+
+		void print_frame_stats() const {
+			auto stats = frame_stats();
+			std::cout << "Frames: " << stats.frame_ct
+				  << ", avg " << stats.avg << " ms"
+				  << ", p50 " << stats.p50 << " ms"
+				  << ", p95 " << stats.p95 << " ms"
+				  << ", p99 " << stats.p99 << " ms"
+				  << ", max " << stats.max << " ms"
+				  << ", stutters " << stats.stutter_ct << std::endl;
+		}
+
+		// One flat object, so results from different builds can be
+		// diffed or loaded by a script
+		void write_frame_stats(const std::string& filename) const {
+			std::ofstream file(filename);
+			if (!file.is_open()) throw std::runtime_error("Could not open " + filename + "!");
+
+			auto stats = frame_stats();
+			file << "{\n"
+			     << "  \"frame_ct\": " << stats.frame_ct << ",\n"
+			     << "  \"avg_ms\": " << stats.avg << ",\n"
+			     << "  \"p50_ms\": " << stats.p50 << ",\n"
+			     << "  \"p95_ms\": " << stats.p95 << ",\n"
+			     << "  \"p99_ms\": " << stats.p99 << ",\n"
+			     << "  \"max_ms\": " << stats.max << ",\n"
+			     << "  \"stutter_ct\": " << stats.stutter_ct << ",\n"
+			     << "  \"stutter_factor\": " << STUTTER_FACTOR << ",\n"
+			     << "  \"bucket_width_ms\": " << BUCKET_WIDTH << "\n"
+			     << "}\n";
+		}
+
 	private:
 		chrono::high_resolution_clock::time_point begin;
+		chrono::high_resolution_clock::time_point last_frame;
+
+		std::array<uint64_t, BUCKET_CT> histogram{};
+		uint64_t frame_ct = 0;
+		double total_ms = 0.0;
+		double max_ms = 0.0;
+
+		// Upper edge of the bucket containing the p-th frame, but never
+		// more than the slowest frame actually seen
+		auto percentile(double p) const -> double {
+			auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * frame_ct)));
+
+			uint64_t seen = 0;
+			for (uint32_t i = 0; i < BUCKET_CT; ++i) {
+				seen += histogram[i];
+				if (seen >= rank) return std::min((i + 1) * BUCKET_WIDTH, max_ms);
+			}
+
+			return max_ms;
+		}
 	};
 }
 
@@ -0,0 +1,74 @@
+#include "uniform_ring.hpp"
+
+#include "ll/buffer.hpp"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace uniform_ring {
+	static auto align_up(VkDeviceSize value, VkDeviceSize alignment) -> VkDeviceSize {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	Ring::Ring(ll::memory::Allocator& allocator, VkPhysicalDevice phys_dev, VkDevice device, uint32_t frame_ct,
+		   VkDeviceSize frame_size, VkDeviceSize range)
+		: allocator(allocator), device(device), range(range), frame_ct(frame_ct)
+	{
+		if (frame_ct == 0) throw std::runtime_error("Need at least one frame in flight!");
+
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(phys_dev, &props);
+		alignment = props.limits.minUniformBufferOffsetAlignment;
+		if (range > props.limits.maxUniformBufferRange)
+			throw std::runtime_error("Uniform ring range is larger than maxUniformBufferRange!");
+
+		// Keeps every frame's region aligned too
+		this->frame_size = align_up(frame_size, alignment);
+		// A descriptor at the very end still sees range bytes
+		auto size = this->frame_size * frame_ct + range;
+		// Dynamic offsets are 32 bits
+		if (size > std::numeric_limits<uint32_t>::max())
+			throw std::runtime_error("Uniform ring is too large!");
+
+		buffer = ll::buffer::create(device, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+		memory = allocator.bind(buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+
+	Ring::~Ring() {
+		vkDestroyBuffer(device, buffer, nullptr);
+		allocator.free(memory);
+	}
+
+	void Ring::begin_frame(uint32_t idx) {
+		if (idx >= frame_ct) throw std::runtime_error("Frame index out of range!");
+		frame_idx = idx;
+		head = 0;
+	}
+
+	auto Ring::push(const void* data, VkDeviceSize size) -> uint32_t {
+		if (size > range) throw std::runtime_error("Uniform block is larger than the ring's range!");
+
+		auto offset = align_up(head, alignment);
+		if (offset + size > frame_size) throw std::runtime_error("Uniform ring is full!");
+		head = offset + size;
+
+		auto absolute = frame_idx * frame_size + offset;
+		std::memcpy(static_cast<char*>(memory.mapped) + absolute, data, size);
+
+		return static_cast<uint32_t>(absolute);
+	}
+
+	void Ring::flush() {
+		if (head == 0) return;
+		allocator.flush(memory, frame_idx * frame_size, head);
+	}
+
+	void Ring::write_descriptor(ll::descriptor::Writer& writer, VkDescriptorSet set, uint32_t binding) const {
+		writer.buffer(set, binding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, buffer, 0, range);
+	}
+
+	auto Ring::used() const -> VkDeviceSize {
+		return head;
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#include "ll/descriptor.hpp"
+#include "ll/memory.hpp"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+namespace uniform_ring {
+	const VkDeviceSize DEFAULT_FRAME_SIZE = 1024ULL * 1024;
+	// How much one descriptor can see past its dynamic offset, so the
+	// largest block a shader can read through the ring
+	const VkDeviceSize DEFAULT_RANGE = 256;
+
+	// A persistently mapped uniform buffer for small per-draw data like
+	// transforms. Every frame in flight gets its own region, which is
+	// filled front to back with blocks aligned to
+	// minUniformBufferOffsetAlignment and emptied all at once in
+	// begin_frame().
+	//
+	// Shaders see it through a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+	// descriptor (see write_descriptor()) which is written once. Each draw
+	// only passes the offset push() returned as the set's dynamic offset,
+	// so per-draw data costs a memcpy and no descriptor writes.
+	//
+	// Not thread-safe.
+	struct Ring {
+		VkBuffer buffer = VK_NULL_HANDLE;
+
+		Ring(ll::memory::Allocator& allocator, VkPhysicalDevice phys_dev, VkDevice device, uint32_t frame_ct,
+		     VkDeviceSize frame_size = DEFAULT_FRAME_SIZE, VkDeviceSize range = DEFAULT_RANGE);
+		~Ring();
+
+		Ring(const Ring&) = delete;
+		auto operator=(const Ring&) -> Ring& = delete;
+
+		// Only call once the GPU is done with the frame that last used
+		// this index
+		void begin_frame(uint32_t frame_idx);
+
+		// Copies size bytes (at most the ring's range) into the current
+		// frame's region and returns their dynamic offset. Throws if
+		// the region is full.
+		auto push(const void* data, VkDeviceSize size) -> uint32_t;
+
+		template <typename T>
+		auto push(const T& data) -> uint32_t {
+			return push(&data, sizeof(T));
+		}
+
+		// Makes this frame's writes visible to the device, needed if
+		// the memory isn't coherent. Call before submitting.
+		void flush();
+
+		// Queues a write pointing binding of set at the ring. Only
+		// needed once per set, the offsets change, the descriptor doesn't.
+		void write_descriptor(ll::descriptor::Writer& writer, VkDescriptorSet set, uint32_t binding) const;
+
+		// Bytes used in the current frame, including alignment padding
+		auto used() const -> VkDeviceSize;
+
+	private:
+		ll::memory::Allocator& allocator;
+		VkDevice device;
+		ll::memory::Allocation memory;
+
+		VkDeviceSize alignment;
+		VkDeviceSize frame_size;
+		VkDeviceSize range;
+		uint32_t frame_ct;
+
+		uint32_t frame_idx = 0;
+		// Relative to the start of the current frame's region
+		VkDeviceSize head = 0;
+	};
+}
+
+#endif // UNIFORM_RING_H
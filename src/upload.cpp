@@ -0,0 +1,344 @@
+#include "upload.hpp"
+
+#include "ll/buffer.hpp"
+#include "ll/cbuf.hpp"
+#include "ll/sync.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace upload {
+	auto buffers(ll::memory::Allocator& allocator, VkDevice device, VkQueue queue, uint32_t queue_fam,
+		     const std::vector<BufferData>& datas,
+		     VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) -> std::vector<Buffer>
+	{
+		std::vector<Buffer> buffers;
+		VkDeviceSize staging_size = 0;
+
+		for (const auto& data : datas) {
+			if (data.size == 0)
+				throw std::runtime_error("Could not upload an empty buffer!");
+		}
+
+		for (const auto& data : datas) {
+			Buffer buffer;
+			buffer.handle = ll::buffer::create(device, data.size, data.usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+			buffer.memory = allocator.bind(buffer.handle, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+			// Integrated GPUs and resizable BAR give us memory we can
+			// write to directly
+			if (buffer.memory.mapped != nullptr) {
+				std::memcpy(buffer.memory.mapped, data.data, data.size);
+				allocator.flush(buffer.memory);
+			} else {
+				staging_size += data.size;
+			}
+
+			buffers.push_back(buffer);
+		}
+
+		if (staging_size == 0) return buffers;
+
+		auto staging = ll::buffer::create(device, staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+		auto staging_memory = allocator.bind(staging, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+		auto cpool = ll::cbuf::pool(device, queue_fam, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+		auto cbuf = ll::cbuf::allocate(device, cpool, 1)[0];
+		ll::cbuf::begin(cbuf, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+		VkDeviceSize offset = 0;
+		for (size_t i = 0; i < datas.size(); ++i) {
+			if (buffers[i].memory.mapped != nullptr) continue;
+
+			std::memcpy(static_cast<char*>(staging_memory.mapped) + offset, datas[i].data, datas[i].size);
+			ll::buffer::copy(cbuf, staging, buffers[i].handle, datas[i].size, offset, 0);
+			ll::buffer::barrier(cbuf, buffers[i].handle,
+					    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+					    dst_stage, dst_access);
+			offset += datas[i].size;
+		}
+		allocator.flush(staging_memory);
+
+		ll::cbuf::end(cbuf);
+
+		auto fence = ll::sync::fence(device);
+		VkSubmitInfo submit_info{};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &cbuf;
+
+		if (vkQueueSubmit(queue, 1, &submit_info, fence) != VK_SUCCESS)
+			throw std::runtime_error("Could not submit upload!");
+		if (vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+			throw std::runtime_error("Could not wait for upload!");
+
+		vkDestroyFence(device, fence, nullptr);
+		vkDestroyCommandPool(device, cpool, nullptr);
+		vkDestroyBuffer(device, staging, nullptr);
+		allocator.free(staging_memory);
+
+		return buffers;
+	}
+
+	auto create(ll::memory::Allocator& allocator, VkDevice device,
+		    VkDeviceSize size, VkBufferUsageFlags usage) -> Buffer {
+		Buffer buffer;
+		buffer.handle = ll::buffer::create(device, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		buffer.memory = allocator.bind(buffer.handle, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		return buffer;
+	}
+
+	void destroy(ll::memory::Allocator& allocator, VkDevice device, const Buffer& buffer) {
+		vkDestroyBuffer(device, buffer.handle, nullptr);
+		allocator.free(buffer.memory);
+	}
+
+	auto mesh(ll::memory::Allocator& allocator, VkDevice device, VkQueue queue, uint32_t queue_fam,
+		  const void* vertices, VkDeviceSize vertices_size, const std::vector<uint32_t>& indices) -> Mesh
+	{
+		VkDeviceSize indices_size = indices.size() * sizeof(uint32_t);
+		auto created = buffers(allocator, device, queue, queue_fam,
+				       {{vertices, vertices_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT},
+					{indices.data(), indices_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT}},
+				       VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+				       VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+
+		return {created[0], created[1], static_cast<uint32_t>(indices.size())};
+	}
+
+	void destroy(ll::memory::Allocator& allocator, VkDevice device, const Mesh& mesh) {
+		destroy(allocator, device, mesh.vertices);
+		destroy(allocator, device, mesh.indices);
+	}
+
+	/*
+	 * Streamer
+	 */
+	static auto ring_aligned(VkDeviceSize size) -> VkDeviceSize {
+		return (size + RING_ALIGNMENT - 1) / RING_ALIGNMENT * RING_ALIGNMENT;
+	}
+
+	Streamer::Streamer(ll::memory::Allocator& allocator, VkDevice device,
+			   VkQueue transfer_queue, uint32_t transfer_fam, uint32_t graphics_fam,
+			   VkDeviceSize ring_size)
+		: allocator(allocator), device(device), queue(transfer_queue),
+		  transfer_fam(transfer_fam), graphics_fam(graphics_fam), ring_size(ring_aligned(ring_size))
+	{
+		cpool = ll::cbuf::pool(device, transfer_fam,
+				       VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
+				       | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+
+		ring = ll::buffer::create(device, this->ring_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+		ring_memory = allocator.bind(ring, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+		start_batch();
+	}
+
+	Streamer::~Streamer() {
+		while (!in_flight.empty()) collect(true);
+
+		free_batches.push_back(pending);
+		for (auto& batch : free_batches) vkDestroyFence(device, batch.fence, nullptr);
+		for (auto& handoff : unacquired) free_sems.push_back(handoff.sem);
+		for (auto sem : free_sems) vkDestroySemaphore(device, sem, nullptr);
+
+		vkDestroyCommandPool(device, cpool, nullptr);
+		vkDestroyBuffer(device, ring, nullptr);
+		allocator.free(ring_memory);
+	}
+
+	void Streamer::start_batch() {
+		if (free_batches.empty()) {
+			pending.cbuf = ll::cbuf::allocate(device, cpool, 1)[0];
+			pending.fence = ll::sync::fence(device);
+		} else {
+			pending = std::move(free_batches.back());
+			free_batches.pop_back();
+		}
+
+		pending.copies.clear();
+		pending.ring_end = head;
+		pending.ring_bytes = 0;
+	}
+
+	auto Streamer::ring_alloc(VkDeviceSize size, VkDeviceSize* offset) -> bool {
+		size = ring_aligned(size);
+		if (used + size > ring_size) return false;
+
+		if (used == 0) head = tail = 0;
+
+		// Free space is [head, ring_size) and [0, tail) if head is
+		// ahead of tail, otherwise just [head, tail)
+		VkDeviceSize taken = 0;
+		if (head >= tail) {
+			if (ring_size - head >= size) {
+				*offset = head;
+				taken = size;
+			} else if (tail >= size) {
+				// Skip whatever's left at the end
+				*offset = 0;
+				taken = ring_size - head + size;
+			} else return false;
+		} else {
+			if (tail - head < size) return false;
+			*offset = head;
+			taken = size;
+		}
+
+		head = *offset + size;
+		used += taken;
+		pending.ring_end = head;
+		pending.ring_bytes += taken;
+
+		return true;
+	}
+
+	void Streamer::collect(bool wait) {
+		while (!in_flight.empty()) {
+			auto& batch = in_flight.front();
+
+			if (wait) {
+				if (vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+					throw std::runtime_error("Could not wait for upload batch!");
+				wait = false;
+			} else if (vkGetFenceStatus(device, batch.fence) != VK_SUCCESS) {
+				break;
+			}
+
+			used -= batch.ring_bytes;
+			tail = batch.ring_end;
+			if (vkResetFences(device, 1, &batch.fence) != VK_SUCCESS)
+				throw std::runtime_error("Could not reset upload fence!");
+
+			free_batches.push_back(std::move(batch));
+			in_flight.pop_front();
+		}
+	}
+
+	auto Streamer::ownership_barriers(const std::vector<Copy>& copies,
+					  VkAccessFlags src_access, VkAccessFlags dst_access) const
+		-> std::vector<VkBufferMemoryBarrier>
+	{
+		std::vector<VkBufferMemoryBarrier> barriers;
+		for (const auto& copy : copies) {
+			auto same_dst = [&](const VkBufferMemoryBarrier& b) { return b.buffer == copy.dst; };
+			if (std::any_of(barriers.begin(), barriers.end(), same_dst)) continue;
+
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = src_access;
+			barrier.dstAccessMask = dst_access;
+			barrier.srcQueueFamilyIndex = transfer_fam;
+			barrier.dstQueueFamilyIndex = graphics_fam;
+			barrier.buffer = copy.dst;
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+			barriers.push_back(barrier);
+		}
+
+		return barriers;
+	}
+
+	void Streamer::upload(VkBuffer dst, const void* data, VkDeviceSize size) {
+		if (size == 0) return;
+		if (ring_aligned(size) > ring_size) throw std::runtime_error("Upload is larger than the staging ring!");
+
+		collect(false);
+
+		VkDeviceSize offset = 0;
+		while (!ring_alloc(size, &offset)) {
+			// Nothing left to wait for, so the ring is empty and waiting
+			// won't make room
+			if (in_flight.empty() && pending.copies.empty())
+				throw std::runtime_error("Upload doesn't fit in the empty staging ring!");
+
+			// Only pending copies are left, so get them going
+			if (in_flight.empty()) flush();
+			collect(true);
+		}
+
+		std::memcpy(static_cast<char*>(ring_memory.mapped) + offset, data, size);
+		pending.copies.push_back({dst, {offset, 0, size}});
+	}
+
+	void Streamer::flush() {
+		if (pending.copies.empty()) return;
+
+		allocator.flush(ring_memory);
+
+		auto cbuf = pending.cbuf;
+		ll::cbuf::begin(cbuf, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+		for (const auto& copy : pending.copies) vkCmdCopyBuffer(cbuf, ring, copy.dst, 1, &copy.region);
+
+		if (transfer_fam != graphics_fam) {
+			// Dst access is ignored for a release
+			auto releases = ownership_barriers(pending.copies, VK_ACCESS_TRANSFER_WRITE_BIT, 0);
+			vkCmdPipelineBarrier(cbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+					     0, nullptr, releases.size(), releases.data(), 0, nullptr);
+		}
+
+		ll::cbuf::end(cbuf);
+
+		VkSemaphore sem{};
+		if (free_sems.empty()) {
+			sem = ll::sync::semaphore(device);
+		} else {
+			sem = free_sems.back();
+			free_sems.pop_back();
+		}
+
+		VkSubmitInfo submit_info{};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &cbuf;
+		submit_info.signalSemaphoreCount = 1;
+		submit_info.pSignalSemaphores = &sem;
+
+		if (vkQueueSubmit(queue, 1, &submit_info, pending.fence) != VK_SUCCESS)
+			throw std::runtime_error("Could not submit upload batch!");
+
+		unacquired.push_back({sem, pending.copies});
+		in_flight.push_back(std::move(pending));
+		start_batch();
+	}
+
+	auto Streamer::acquire(VkCommandBuffer cbuf, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access)
+		-> std::vector<VkSemaphore>
+	{
+		std::vector<VkSemaphore> sems;
+		std::vector<VkBufferMemoryBarrier> acquires;
+
+		for (const auto& handoff : unacquired) {
+			sems.push_back(handoff.sem);
+
+			// Within one family, the semaphore is all the
+			// synchronization we need. Otherwise every release needs
+			// its matching acquire, even if a buffer was released by
+			// several batches.
+			if (transfer_fam == graphics_fam) continue;
+			// Src access is ignored for an acquire
+			auto batch_acquires = ownership_barriers(handoff.copies, 0, dst_access);
+			acquires.insert(acquires.end(), batch_acquires.begin(), batch_acquires.end());
+		}
+		unacquired.clear();
+
+		if (!acquires.empty()) {
+			vkCmdPipelineBarrier(cbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dst_stage, 0,
+					     0, nullptr, acquires.size(), acquires.data(), 0, nullptr);
+		}
+
+		return sems;
+	}
+
+	void Streamer::recycle(const std::vector<VkSemaphore>& sems) {
+		free_sems.insert(free_sems.end(), sems.begin(), sems.end());
+	}
+
+	auto Streamer::ring_used() const -> VkDeviceSize {
+		return used;
+	}
+}
@@ -0,0 +1,170 @@
+#ifndef UPLOAD_H
+#define UPLOAD_H
+
+#include "ll/memory.hpp"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace upload {
+	// A buffer and the memory bound to it
+	struct Buffer {
+		VkBuffer handle = VK_NULL_HANDLE;
+		ll::memory::Allocation memory;
+	};
+
+	struct BufferData {
+		const void* data;
+		VkDeviceSize size;
+		VkBufferUsageFlags usage;
+	};
+
+	// Creates one device-local buffer per entry and fills it. Goes through
+	// a single staging buffer and submission, unless the memory turns out
+	// to be host-visible too, in which case it's written directly.
+	//
+	// Blocks until the copies are done, so this is for loading rather than
+	// every frame. Afterwards the buffers are ready for dst_access in
+	// dst_stage on queue's family. Throws if any entry is empty.
+	auto buffers(ll::memory::Allocator& allocator, VkDevice device, VkQueue queue, uint32_t queue_fam,
+		     const std::vector<BufferData>& datas,
+		     VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) -> std::vector<Buffer>;
+
+	// Creates an empty device-local buffer that can be copied to
+	auto create(ll::memory::Allocator& allocator, VkDevice device,
+		    VkDeviceSize size, VkBufferUsageFlags usage) -> Buffer;
+
+	void destroy(ll::memory::Allocator& allocator, VkDevice device, const Buffer& buffer);
+
+	struct Mesh {
+		Buffer vertices;
+		Buffer indices;
+		uint32_t index_ct;
+	};
+
+	auto mesh(ll::memory::Allocator& allocator, VkDevice device, VkQueue queue, uint32_t queue_fam,
+		  const void* vertices, VkDeviceSize vertices_size, const std::vector<uint32_t>& indices) -> Mesh;
+
+	template <typename Vertex>
+	auto mesh(ll::memory::Allocator& allocator, VkDevice device, VkQueue queue, uint32_t queue_fam,
+		  const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) -> Mesh {
+		return mesh(allocator, device, queue, queue_fam,
+			    vertices.data(), vertices.size() * sizeof(Vertex), indices);
+	}
+
+	void destroy(ll::memory::Allocator& allocator, VkDevice device, const Mesh& mesh);
+
+	const VkDeviceSize DEFAULT_RING_SIZE = 16ULL * 1024 * 1024;
+	// Keeps copies nicely aligned in the staging ring
+	const VkDeviceSize RING_ALIGNMENT = 16;
+
+	// Streams data into buffers from a transfer queue, so uploads can
+	// happen while rendering continues on the graphics queue.
+	//
+	// Data is copied into a persistently mapped staging ring right away.
+	// The copies out of it are batched until flush(), which submits them
+	// all at once. When the transfer queue belongs to a different family
+	// than the graphics queue, every destination buffer is released to the
+	// graphics family at the end of each batch, and acquire() records the
+	// matching acquire barriers.
+	//
+	// Uploads always replace a buffer's whole contents. Ownership moves
+	// with whole buffers, so the transfer queue can overwrite a buffer
+	// the graphics family already owns without getting it back first,
+	// which wouldn't be true if part of the old contents had to survive.
+	//
+	// Not thread-safe.
+	struct Streamer {
+		// Pass the graphics queue and family as transfer_* if there is
+		// no dedicated transfer queue. Ring_size is rounded up to
+		// RING_ALIGNMENT.
+		Streamer(ll::memory::Allocator& allocator, VkDevice device,
+			 VkQueue transfer_queue, uint32_t transfer_fam, uint32_t graphics_fam,
+			 VkDeviceSize ring_size = DEFAULT_RING_SIZE);
+		~Streamer();
+
+		Streamer(const Streamer&) = delete;
+		auto operator=(const Streamer&) -> Streamer& = delete;
+
+		// Queues a copy of data into dst, size has to be dst's size.
+		// If the ring is full, pending copies are flushed and this
+		// waits for the oldest batches. Dst mustn't be in use by the
+		// GPU until it has been acquired.
+		void upload(VkBuffer dst, const void* data, VkDeviceSize size);
+
+		// Submits everything queued so far as one batch
+		void flush();
+
+		// Records acquire barriers for every batch flushed since the
+		// last call, making the data available to dst_access in
+		// dst_stage. The returned semaphores must be waited on (at
+		// dst_stage) by the submission containing cbuf, and handed
+		// back through recycle() once that submission has finished.
+		auto acquire(VkCommandBuffer cbuf, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access)
+			-> std::vector<VkSemaphore>;
+
+		void recycle(const std::vector<VkSemaphore>& sems);
+
+		// Bytes waiting to be flushed plus bytes being copied
+		auto ring_used() const -> VkDeviceSize;
+
+	private:
+		struct Copy {
+			VkBuffer dst;
+			VkBufferCopy region;
+		};
+
+		struct Batch {
+			VkCommandBuffer cbuf;
+			VkFence fence;
+			std::vector<Copy> copies;
+			// Where the ring's head was after this batch's last copy,
+			// and how many bytes it took up (counting any wasted at
+			// the end of the ring)
+			VkDeviceSize ring_end;
+			VkDeviceSize ring_bytes;
+		};
+
+		// A flushed batch the graphics queue hasn't acquired yet
+		struct Handoff {
+			VkSemaphore sem;
+			std::vector<Copy> copies;
+		};
+
+		ll::memory::Allocator& allocator;
+		VkDevice device;
+		VkQueue queue;
+		uint32_t transfer_fam;
+		uint32_t graphics_fam;
+
+		VkCommandPool cpool;
+		VkBuffer ring;
+		ll::memory::Allocation ring_memory;
+		VkDeviceSize ring_size;
+		VkDeviceSize head = 0;
+		VkDeviceSize tail = 0;
+		VkDeviceSize used = 0;
+
+		Batch pending{};
+		// Submitted, oldest first
+		std::deque<Batch> in_flight;
+		std::vector<Handoff> unacquired;
+		// Command buffers and fences of finished batches
+		std::vector<Batch> free_batches;
+		std::vector<VkSemaphore> free_sems;
+
+		auto ring_alloc(VkDeviceSize size, VkDeviceSize* offset) -> bool;
+		// Reclaims ring space from finished batches. Waits for the
+		// oldest one first if wait is set.
+		void collect(bool wait);
+		void start_batch();
+		// Transfer to graphics family barriers, one per buffer and
+		// covering all of it
+		auto ownership_barriers(const std::vector<Copy>& copies, VkAccessFlags src_access,
+					VkAccessFlags dst_access) const -> std::vector<VkBufferMemoryBarrier>;
+	};
+}
+
+#endif // UPLOAD_H